@@ -0,0 +1,84 @@
+#ifndef accumulator_h
+#define accumulator_h
+
+#include <vector>
+#include <cstring>
+
+
+// Dense accumulators indexed by docid with the list of the documents touched since the last reset, so that they can be reused
+// from one query (or one value of a parameter) to the next : reset only costs the number of documents touched. One per thread
+class ScoreAccumulator {
+
+public:
+
+	ScoreAccumulator(){}
+
+	//size is the largest docid + 1
+	ScoreAccumulator(const size_t size){resize(size);}
+
+	void resize(const size_t size);
+
+	size_t size()const{return values.size();}
+
+	//Add value to the accumulator of doc , doc is touched even if value is 0
+	void add(const int doc , const double value){
+
+		if(!marks[doc]){
+
+			marks[doc] = 1;
+			touched.push_back(doc);
+
+		}
+
+		values[doc] += value;
+
+	}
+
+	double value(const int doc)const{return values[doc];}
+
+	//Return true if doc has been touched since the last reset
+	bool contains(const int doc)const{return marks[doc] != 0;}
+
+	//Documents touched since the last reset , in the order they were first touched
+	const std::vector<int>& touched_docs()const{return touched;}
+
+	//Set back to 0 the accumulators of the documents touched
+	void reset();
+
+
+private:
+
+	std::vector<double> values;
+
+	std::vector<char> marks;
+
+	std::vector<int> touched;
+
+};
+
+
+void ScoreAccumulator::resize(const size_t size){
+
+	reset();
+
+	values.resize(size , 0);
+	marks.resize(size , 0);
+
+}
+
+
+void ScoreAccumulator::reset(){
+
+	for(unsigned int l = 0 ; l < touched.size() ; l++){
+
+		values[touched[l]] = 0;
+		marks[touched[l]] = 0;
+
+	}
+
+	touched.clear();
+
+}
+
+
+#endif
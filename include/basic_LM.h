@@ -4,6 +4,7 @@
 
 #include "frequency.h"
 #include "tool.h"
+#include "inverted_index.h"
 #include <cstring>
 #include <vector>
 #include <unordered_map>
@@ -64,15 +65,144 @@ std::vector< std::vector< std::pair<int,double> > > basic_language_model(const s
 
 	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
 
-	auto iterator = queries.begin();
+	std::vector<int> query_ids = queries_by_length(queries);
 
-	while( iterator != queries.end() ){
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
 
 		//std::cout<<"\rProcessing query "<<i+1<<"/"<<queries.size()<<std::flush;
 
 		list_docs[iterator->first] = kfirst_docs( basic_language_model(iterator->second , collection) , k);
 
-		iterator++;
+	}
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but with an indexed query , from the tf of each term of the query in the document and the length of the document
+double basic_language_model(const std::vector<int> &query , const std::vector<int> &tfs , const int doc_length){
+
+	if(doc_length == 0){return 0;}
+
+	double proba = 0;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		if( find(query.begin() , query.begin() + i , query[i]) == query.begin() + i ){
+			proba += log( 1 + (double)tfs[i]/doc_length );
+
+		}
+
+	}
+
+	return proba;
+
+}
+
+
+
+//Same as before but over a document store , whose documents are read in docid order
+std::unordered_map <int,double> basic_language_model(const std::vector<int> &query , const DocumentStore &documents){
+
+	std::unordered_map <int,double> list_doc;
+
+	double proba;
+
+	std::vector<int> tfs(query.size());
+
+	for(unsigned int i = 0 ; i < documents.nb_docs() ; i++){
+
+		for(unsigned int j = 0 ; j < query.size() ; j++){tfs[j] = term_freq(documents.document(i) , query[j]);}
+
+		proba = basic_language_model(query , tfs , documents.doc_length(i));
+		if(proba > 0){list_doc[documents.id(i)]=proba;}
+
+	}
+
+	return list_doc;
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > basic_language_model(const std::unordered_map <int , std::vector<int> > &queries , const DocumentStore &documents , const int k){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		list_docs[iterator->first] = kfirst_docs( basic_language_model(iterator->second , documents) , k);
+
+	}
+
+	return list_docs;
+
+}
+
+
+//Same as before but over the entire collection using the inverted index : only the documents that contain a term of the query can have a non zero probability.
+//The documents are pushed into collector , which keeps the k best of them (k being the capacity of the collector)
+void basic_language_model(const std::vector<int> &query , const InvertedIndex &inverted_index , TopkCollector &collector){
+
+	double proba;
+
+	CandidateIterator candidates(query , inverted_index);
+
+	while(candidates.next()){
+
+		proba = basic_language_model(query , candidates.tfs() , inverted_index.doc_length(candidates.doc()));
+		if(proba > 0){collector.push(candidates.doc() , proba);}
+
+	}
+
+}
+
+
+//Same as before but the scores of all the documents are returned in a map
+std::unordered_map <int,double> basic_language_model(const std::vector<int> &query , const InvertedIndex &inverted_index){
+
+	TopkCollector collector(-1);
+
+	basic_language_model(query , inverted_index , collector);
+
+	return collector.scores();
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > basic_language_model(const std::unordered_map <int , std::vector<int> > &queries , const InvertedIndex &inverted_index , const int k){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel
+	{
+
+		//Every thread has its own collector and reuses it for its queries
+		TopkCollector collector(k);
+
+		#pragma omp for schedule(dynamic)
+		for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+			auto iterator = queries.find(query_ids[q]);
+
+			collector.reset();
+			basic_language_model(iterator->second , inverted_index , collector);
+			list_docs[iterator->first] = collector.results();
+
+		}
 
 	}
 
@@ -0,0 +1,285 @@
+#ifndef binary_image_h
+#define binary_image_h
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+//Every array of a binary image starts on a multiple of this number of bytes
+#define binary_image_alignment 64
+
+
+// Binary image written array by array : a magic number and a version , then for every array its number of elements (uint64_t) and its content,
+// aligned on binary_image_alignment bytes so that it can be used in place once the file is mapped in memory (see BinaryImageReader)
+class BinaryImageWriter {
+
+public:
+
+	BinaryImageWriter(const std::string &file_name , const uint32_t magic , const uint32_t version);
+
+	//Return false if the file could not be opened or if a write failed
+	bool good()const{return myfile.good();}
+
+	template<typename T>
+	void write_array(const T* data , const uint64_t size);
+
+	template<typename T>
+	void write_array(const std::vector<T> &data){write_array(data.data() , data.size());}
+
+	template<typename T>
+	void write_value(const T &value){write_array(&value , 1);}
+
+	//Write the name , the size and the modification time of a file the image is built from (see BinaryImageReader::read_source)
+	void write_source(const std::string &source_file);
+
+	//Flush the file , return false if something could not be written
+	bool close();
+
+
+private:
+
+	//Write zeros up to the next multiple of binary_image_alignment
+	void pad();
+
+	std::ofstream myfile;
+
+	uint64_t position;
+
+};
+
+
+BinaryImageWriter::BinaryImageWriter(const std::string &file_name , const uint32_t magic , const uint32_t version) : myfile(file_name.c_str() , std::ofstream::binary | std::ofstream::trunc) , position(0) {
+
+	myfile.write((const char*)&magic , sizeof(uint32_t));
+	myfile.write((const char*)&version , sizeof(uint32_t));
+	position = 2*sizeof(uint32_t);
+
+}
+
+
+void BinaryImageWriter::pad(){
+
+	static const char zeros[binary_image_alignment] = {0};
+
+	uint64_t padding = (binary_image_alignment - position % binary_image_alignment) % binary_image_alignment;
+
+	myfile.write(zeros , padding);
+	position += padding;
+
+}
+
+
+template<typename T>
+void BinaryImageWriter::write_array(const T* data , const uint64_t size){
+
+	myfile.write((const char*)&size , sizeof(uint64_t));
+	position += sizeof(uint64_t);
+
+	pad();
+
+	myfile.write((const char*)data , size*sizeof(T));
+	position += size*sizeof(T);
+
+}
+
+
+void BinaryImageWriter::write_source(const std::string &source_file){
+
+	//-1 if the file does not exist
+	int64_t fingerprint[2] = {-1 , -1};
+
+	struct stat status;
+
+	if(stat(source_file.c_str() , &status) == 0){
+
+		fingerprint[0] = status.st_size;
+		fingerprint[1] = status.st_mtime;
+
+	}
+
+	write_array(source_file.c_str() , source_file.size());
+	write_array(fingerprint , 2);
+
+}
+
+
+bool BinaryImageWriter::close(){
+
+	myfile.close();
+	return !myfile.fail();
+
+}
+
+
+
+// Binary image written by a BinaryImageWriter , mapped in memory and read array by array in the order they were written.
+// The arrays are returned as pointers into the mapping , valid as long as the reader exists , or copied into vectors
+class BinaryImageReader {
+
+public:
+
+	BinaryImageReader(const std::string &file_name , const uint32_t magic , const uint32_t version);
+
+	~BinaryImageReader();
+
+	//Return false if the file could not be mapped , is not an image with this magic number and version , or is truncated
+	bool good()const{return valid;}
+
+	//Next array , nullptr if the image is truncated
+	template<typename T>
+	const T* read_array(uint64_t &size);
+
+	template<typename T>
+	bool read_array(std::vector<T> &data);
+
+	template<typename T>
+	bool read_value(T &value);
+
+	//Read the name of a file written by write_source , return false if the image is truncated or if this file has been modified since
+	//(a file that no longer exists is not checked)
+	bool read_source(std::string &source_file);
+
+
+private:
+
+	BinaryImageReader(const BinaryImageReader&);
+
+	BinaryImageReader& operator=(const BinaryImageReader&);
+
+	const char* data;
+
+	uint64_t length;
+
+	uint64_t position;
+
+	bool valid;
+
+};
+
+
+BinaryImageReader::BinaryImageReader(const std::string &file_name , const uint32_t magic , const uint32_t version) : data(nullptr) , length(0) , position(0) , valid(false) {
+
+	int descriptor = open(file_name.c_str() , O_RDONLY);
+
+	if(descriptor == -1){return;}
+
+	struct stat status;
+
+	if(fstat(descriptor , &status) == 0 && status.st_size >= (off_t)(2*sizeof(uint32_t))){
+
+		void* mapping = mmap(nullptr , status.st_size , PROT_READ , MAP_PRIVATE , descriptor , 0);
+
+		if(mapping != MAP_FAILED){
+
+			data = (const char*)mapping;
+			length = status.st_size;
+
+		}
+
+	}
+
+	close(descriptor);
+
+	if(data == nullptr){return;}
+
+	uint32_t header[2];
+	std::memcpy(header , data , sizeof(header));
+	position = sizeof(header);
+
+	valid = header[0] == magic && header[1] == version;
+
+}
+
+
+BinaryImageReader::~BinaryImageReader(){
+
+	if(data != nullptr){munmap((void*)data , length);}
+
+}
+
+
+template<typename T>
+const T* BinaryImageReader::read_array(uint64_t &size){
+
+	size = 0;
+
+	if(!valid || position + sizeof(uint64_t) > length){valid = false; return nullptr;}
+
+	std::memcpy(&size , data + position , sizeof(uint64_t));
+	position += sizeof(uint64_t);
+	position += (binary_image_alignment - position % binary_image_alignment) % binary_image_alignment;
+
+	if(position > length || size > (length - position)/sizeof(T)){
+
+		valid = false;
+		size = 0;
+		return nullptr;
+
+	}
+
+	const T* array = (const T*)(data + position);
+	position += size*sizeof(T);
+
+	return array;
+
+}
+
+
+template<typename T>
+bool BinaryImageReader::read_array(std::vector<T> &data){
+
+	uint64_t size;
+	const T* array = read_array<T>(size);
+
+	if(array == nullptr){return false;}
+
+	data.assign(array , array + size);
+
+	return true;
+
+}
+
+
+template<typename T>
+bool BinaryImageReader::read_value(T &value){
+
+	uint64_t size;
+	const T* array = read_array<T>(size);
+
+	if(array == nullptr || size != 1){valid = false; return false;}
+
+	value = *array;
+
+	return true;
+
+}
+
+
+bool BinaryImageReader::read_source(std::string &source_file){
+
+	uint64_t nb_characters , nb_values;
+
+	const char* characters = read_array<char>(nb_characters);
+	const int64_t* fingerprint = read_array<int64_t>(nb_values);
+
+	if(characters == nullptr || fingerprint == nullptr || nb_values != 2){valid = false; return false;}
+
+	source_file.assign(characters , nb_characters);
+
+	struct stat status;
+
+	if(stat(source_file.c_str() , &status) != 0){return true;}
+
+	return status.st_size == fingerprint[0] && status.st_mtime == fingerprint[1];
+
+}
+
+
+#endif
@@ -0,0 +1,446 @@
+#ifndef binary_index_h
+#define binary_index_h
+
+#include "readwrite.h"
+#include "binary_image.h"
+#include "document_store.h"
+#include "inverted_index.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+
+
+//Magic number ("CIDX") and version of the binary image of an indexed collection
+static const uint32_t collection_image_magic = 0x43494458;
+static const uint32_t collection_image_version = 2;
+
+//Magic number ("CSHD") and version of the binary image of one shard of a collection
+static const uint32_t shard_image_magic = 0x43534844;
+static const uint32_t shard_image_version = 1;
+
+
+// Binary image of an indexed collection , written by the "index" command of main : the text files it is built from (see
+// BinaryImageWriter::write_source) , the vocabulary , the document store , the postings lists (with the lengths of the documents) , the indexed queries and cf. Loading it maps the file and copies every array in one block instead of
+// reading , splitting and indexing the text files again
+
+
+//Write the vocabulary : the id of every term and its characters
+void write_vocabulary(BinaryImageWriter &image , const std::unordered_map <std::string,int> &index){
+
+	std::vector<int> term_ids;
+	std::vector<uint64_t> term_offsets(1 , 0);
+	std::vector<char> characters;
+
+	for(auto iterator = index.begin() ; iterator != index.end() ; iterator++){
+
+		term_ids.push_back(iterator->second);
+		characters.insert(characters.end() , iterator->first.begin() , iterator->first.end());
+		term_offsets.push_back(characters.size());
+
+	}
+
+	image.write_array(term_ids);
+	image.write_array(term_offsets);
+	image.write_array(characters);
+
+}
+
+
+//Read a vocabulary written by write_vocabulary , return false if the image is truncated or inconsistent
+bool read_vocabulary(BinaryImageReader &image , std::unordered_map <std::string,int> &index){
+
+	uint64_t nb_terms , nb_offsets , nb_characters;
+
+	const int* term_ids = image.read_array<int>(nb_terms);
+	const uint64_t* term_offsets = image.read_array<uint64_t>(nb_offsets);
+	const char* characters = image.read_array<char>(nb_characters);
+
+	if(!image.good() || nb_offsets != nb_terms + 1 || term_offsets[0] != 0 || term_offsets[nb_terms] != nb_characters){return false;}
+
+	for(uint64_t t = 0 ; t < nb_terms ; t++){
+
+		if(term_offsets[t] > term_offsets[t+1]){return false;}
+
+	}
+
+	index.clear();
+	index.reserve(nb_terms);
+
+	for(uint64_t t = 0 ; t < nb_terms ; t++){index[std::string(characters + term_offsets[t] , term_offsets[t+1] - term_offsets[t])] = term_ids[t];}
+
+	return true;
+
+}
+
+
+//Write cf as two arrays , the terms and their collection frequencies
+void write_cf(BinaryImageWriter &image , const std::unordered_map <int,int> &cf){
+
+	std::vector<int> cf_terms;
+	std::vector<int> cf_values;
+
+	for(auto iterator = cf.begin() ; iterator != cf.end() ; iterator++){
+
+		cf_terms.push_back(iterator->first);
+		cf_values.push_back(iterator->second);
+
+	}
+
+	image.write_array(cf_terms);
+	image.write_array(cf_values);
+
+}
+
+
+//Read cf written by write_cf , return false if the image is truncated
+bool read_cf(BinaryImageReader &image , std::unordered_map <int,int> &cf){
+
+	uint64_t nb_cf , nb_values;
+
+	const int* cf_terms = image.read_array<int>(nb_cf);
+	const int* cf_values = image.read_array<int>(nb_values);
+
+	if(!image.good() || nb_cf != nb_values){return false;}
+
+	cf.clear();
+	cf.reserve(nb_cf);
+
+	for(uint64_t t = 0 ; t < nb_cf ; t++){cf[cf_terms[t]] = cf_values[t];}
+
+	return true;
+
+}
+
+
+//Write the queries , in the same form as the documents
+void write_queries(BinaryImageWriter &image , const std::unordered_map< int , std::vector<int> > &queries){
+
+	DocumentStore indexed_queries(queries);
+	indexed_queries.write(image);
+
+}
+
+
+//Read queries written by write_queries , return false if the image is truncated or inconsistent
+bool read_queries(BinaryImageReader &image , std::unordered_map< int , std::vector<int> > &queries){
+
+	DocumentStore indexed_queries;
+
+	if(!indexed_queries.read(image)){return false;}
+
+	queries.clear();
+
+	for(unsigned int i = 0 ; i < indexed_queries.nb_docs() ; i++){
+
+		DocumentView view = indexed_queries.document(i);
+		queries[indexed_queries.id(i)].assign(view.begin() , view.end());
+
+	}
+
+	return true;
+
+}
+
+
+//Write the image of an indexed collection read from collection_file and queries_file , return false if the file could not be written
+bool write_collection_image(const std::string &file_name , const std::string &collection_file , const std::string &queries_file , const std::unordered_map <std::string,int> &index , const DocumentStore &documents , const InvertedIndex &inverted_index , const std::unordered_map< int , std::vector<int> > &queries , const std::unordered_map <int,int> &cf){
+
+	BinaryImageWriter image(file_name , collection_image_magic , collection_image_version);
+
+	image.write_source(collection_file);
+	image.write_source(queries_file);
+
+	write_vocabulary(image , index);
+
+	documents.write(image);
+	inverted_index.write(image);
+
+	write_queries(image , queries);
+	write_cf(image , cf);
+
+	return image.close();
+
+}
+
+
+//Read the text files an image was built from , collection_file getting the name of the collection. Return false if the image is truncated ,
+//if one of the files has been modified since the image was written or if the queries were not read from queries_file
+bool read_collection_sources(BinaryImageReader &image , const std::string &queries_file , std::string &collection_file){
+
+	std::string queries_source;
+
+	return image.read_source(collection_file) && image.read_source(queries_source) && queries_source == queries_file;
+
+}
+
+
+//Read the image of an indexed collection written by write_collection_image with the queries of queries_file , return false if the file
+//is not a valid image or if it is out of date (see read_collection_sources)
+bool read_collection_image(const std::string &file_name , const std::string &queries_file , std::unordered_map <std::string,int> &index , DocumentStore &documents , InvertedIndex &inverted_index , std::unordered_map< int , std::vector<int> > &queries , std::unordered_map <int,int> &cf){
+
+	BinaryImageReader image(file_name , collection_image_magic , collection_image_version);
+
+	std::string collection_file;
+
+	if(!image.good() || !read_collection_sources(image , queries_file , collection_file)){return false;}
+
+	return read_vocabulary(image , index) && documents.read(image) && inverted_index.read(image) && read_queries(image , queries) && read_cf(image , cf);
+
+}
+
+
+//Return true if file_name is the image of an indexed collection
+bool is_collection_image(const std::string &file_name){
+
+	BinaryImageReader image(file_name , collection_image_magic , collection_image_version);
+
+	return image.good();
+
+}
+
+
+//Return image_file if it is an up to date image of collection_file and queries_file , otherwise collection_file (with a message if
+//image_file is an image of other or modified files)
+std::string collection_or_image(const std::string &collection_file , const std::string &queries_file , const std::string &image_file){
+
+	BinaryImageReader image(image_file , collection_image_magic , collection_image_version);
+
+	if(!image.good()){return collection_file;}
+
+	std::string source;
+
+	if(read_collection_sources(image , queries_file , source) && source == collection_file){return image_file;}
+
+	std::cout<<"The collection image "<<image_file<<" is not the one of "<<collection_file<<" and "<<queries_file<<" or is out of date , the text files are read (run the \"index\" command again)"<<std::endl;
+
+	return collection_file;
+
+}
+
+
+//Read and index the collection and the queries then write their image
+bool index_collection(const std::string &collection_file , const std::string &queries_file , const std::string &image_file){
+
+	std::unordered_map< int , std::vector<int> > collection;
+	std::unordered_map< int , std::vector<int> > queries;
+	std::unordered_map <std::string,int> index;
+	std::unordered_map <int,int> cf;
+
+	read_all_info_and_index(collection_file , queries_file , collection , queries , index , cf);
+
+	DocumentStore documents(collection);
+	std::unordered_map< int , std::vector<int> >().swap(collection);
+
+	InvertedIndex inverted_index(documents);
+
+	return write_collection_image(image_file , collection_file , queries_file , index , documents , inverted_index , queries , cf);
+
+}
+
+
+//Load the indexed collection and queries : from the image if collection_file is a collection image (which must have been built with
+//queries_file) , otherwise by reading and indexing the text files. Return false , with everything cleared , if the image could not be read
+bool read_indexed_collection(const std::string &collection_file , const std::string &queries_file , DocumentStore &documents , InvertedIndex &inverted_index , std::unordered_map< int , std::vector<int> > &queries , std::unordered_map <std::string,int> &index , std::unordered_map <int,int> &cf){
+
+	if(is_collection_image(collection_file)){
+
+		if(read_collection_image(collection_file , queries_file , index , documents , inverted_index , queries , cf)){return true;}
+
+		std::cout<<"Could not read the collection image "<<collection_file<<std::endl;
+
+		documents = DocumentStore();
+		inverted_index = InvertedIndex();
+		queries.clear();
+		index.clear();
+		cf.clear();
+
+		return false;
+
+	}
+
+	std::unordered_map< int , std::vector<int> > collection;
+
+	read_all_info_and_index(collection_file , queries_file , collection , queries , index , cf);
+
+	//The collection is only kept in contiguous form
+	documents.build(collection);
+	std::unordered_map< int , std::vector<int> >().swap(collection);
+
+	inverted_index.build(documents);
+
+	return true;
+
+}
+
+
+
+// Image of one shard of a document partitioned collection (see sharded_index.h) , written by write_shard_image and loaded alone by the process
+// that searches the shard : the text files it is built from , the shard and the number of shards , the vocabulary , cf and the size of the whole
+// collection (so that the scores are the ones of a single index) , the indexed queries and the postings lists of the documents of the shard.
+// The text collection is read twice as a stream , the first pass counting cf and the second keeping only the documents of the shard , so that
+// no process holds the whole collection
+
+
+//Read the text file file_name line by line and call process(docid , terms) for every line , the docid being the number of the line and the
+//terms the words of the line that read_file and build_cf keep. Return false if the file could not be opened
+template<typename Process>
+bool stream_documents(const std::string &file_name , const Process &process){
+
+	FILE* f = fopen(file_name.c_str() , "r");
+
+	if(f == NULL){return false;}
+
+	size_t len = 10000;
+
+	char* line = (char*)malloc(len);
+
+	std::vector<std::string> terms;
+
+	for(int docid = 0 ; getline(&line , &len , f) != -1 ; docid++){
+
+		terms = split_maj(std::string(line) , ' ');
+
+		terms.erase(std::remove_if(terms.begin() , terms.end() , [](const std::string &term){return !(term.size() > 1 || isValidChar(term[0]));}) , terms.end());
+
+		process(docid , terms);
+
+	}
+
+	free(line);
+	fclose(f);
+
+	return true;
+
+}
+
+
+//Build the shard shard of nb_shards of the collection of collection_file (the document docid being in the shard docid % nb_shards) with the
+//vocabulary of the whole collection and of the queries , the ids of the terms being given in order of first occurrence so that every process
+//gets the same ids. Return false if a text file could not be read
+bool build_shard(const std::string &collection_file , const std::string &queries_file , const int shard , const int nb_shards , std::unordered_map <std::string,int> &index , std::unordered_map <int,int> &cf , std::unordered_map< int , std::vector<int> > &queries , DocumentStore &documents){
+
+	index.clear();
+	cf.clear();
+	queries.clear();
+
+	//First pass : the vocabulary and cf of the whole collection
+	bool ok = stream_documents(collection_file , [&](const int docid , const std::vector<std::string> &terms){
+
+		for(unsigned int j = 0 ; j < terms.size() ; j++){
+
+			auto it = index.emplace(terms[j] , (int)index.size()).first;
+			cf[it->second]++;
+
+		}
+
+	});
+
+	//The terms that only appear in the queries have a cf of 0
+	ok = ok && stream_documents(queries_file , [&](const int docid , const std::vector<std::string> &terms){
+
+		std::vector<int> &query = queries[docid];
+
+		for(unsigned int j = 0 ; j < terms.size() ; j++){
+
+			auto it = index.emplace(terms[j] , (int)index.size());
+			if(it.second){cf[it.first->second] = 0;}
+			query.push_back(it.first->second);
+
+		}
+
+	});
+
+	//Second pass : only the documents of the shard are kept
+	std::unordered_map< int , std::vector<int> > part;
+
+	ok = ok && stream_documents(collection_file , [&](const int docid , const std::vector<std::string> &terms){
+
+		if(docid % nb_shards != shard){return;}
+
+		std::vector<int> &document = part[docid];
+
+		for(unsigned int j = 0 ; j < terms.size() ; j++){document.push_back(index.at(terms[j]));}
+
+	});
+
+	documents.build(part);
+
+	return ok;
+
+}
+
+
+//Build the shard shard of nb_shards (see build_shard) and write its image in image_file , return false if a file could not be read or written
+bool write_shard_image(const std::string &image_file , const std::string &collection_file , const std::string &queries_file , const int shard , const int nb_shards){
+
+	std::unordered_map <std::string,int> index;
+	std::unordered_map <int,int> cf;
+	std::unordered_map< int , std::vector<int> > queries;
+	DocumentStore documents;
+
+	if(nb_shards < 1 || shard < 0 || shard >= nb_shards || !build_shard(collection_file , queries_file , shard , nb_shards , index , cf , queries , documents)){return false;}
+
+	InvertedIndex inverted_index(documents);
+	documents = DocumentStore();
+
+	BinaryImageWriter image(image_file , shard_image_magic , shard_image_version);
+
+	image.write_source(collection_file);
+	image.write_source(queries_file);
+
+	image.write_value((int32_t)shard);
+	image.write_value((int32_t)nb_shards);
+	image.write_value((uint64_t)get_size_collection(cf));
+
+	write_vocabulary(image , index);
+	write_cf(image , cf);
+	write_queries(image , queries);
+	inverted_index.write(image);
+
+	return image.close();
+
+}
+
+
+//Read the image of a shard written by write_shard_image with the queries of queries_file : its postings lists and the statistics of the whole
+//collection. Return false , with everything cleared , if the file is not a valid image , if it is out of date (see read_collection_sources) or
+//if a document is not in the shard
+bool read_shard_image(const std::string &image_file , const std::string &queries_file , int &shard , int &nb_shards , InvertedIndex &inverted_index , std::unordered_map< int , std::vector<int> > &queries , std::unordered_map <std::string,int> &index , std::unordered_map <int,int> &cf , size_t &collection_size){
+
+	BinaryImageReader image(image_file , shard_image_magic , shard_image_version);
+
+	std::string collection_file;
+	int32_t file_shard = 0 , file_nb_shards = 0;
+	uint64_t file_collection_size = 0;
+
+	bool ok = image.good() && read_collection_sources(image , queries_file , collection_file);
+
+	ok = ok && image.read_value(file_shard) && image.read_value(file_nb_shards) && image.read_value(file_collection_size) && file_nb_shards >= 1 && file_shard >= 0 && file_shard < file_nb_shards;
+
+	ok = ok && read_vocabulary(image , index) && read_cf(image , cf) && read_queries(image , queries) && inverted_index.read(image);
+
+	for(unsigned int i = 0 ; ok && i < inverted_index.doc_ids().size() ; i++){ok = inverted_index.doc_ids()[i] % file_nb_shards == file_shard;}
+
+	if(!ok){
+
+		inverted_index = InvertedIndex();
+		queries.clear();
+		index.clear();
+		cf.clear();
+
+		return false;
+
+	}
+
+	shard = file_shard;
+	nb_shards = file_nb_shards;
+	collection_size = file_collection_size;
+
+	return true;
+
+}
+
+
+#endif
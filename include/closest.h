@@ -17,14 +17,19 @@ std::unordered_map<std::string,double> closest_terms(const std::string &term , c
 
 	std::unordered_map<std::string,double> most_sim;
 
-	if(embedding.get(term.c_str())==nullptr){return most_sim;}
+	//The id of term is only looked up once , the similarities are computed with the storage of the embedding (see Embedding::quantize)
+	const int id = embedding.find(term.c_str());
+
+	if(id == -1){return most_sim;}
 
 	float cos;
 
 	auto iterator = cf.begin();
 	while(iterator != cf.end()){
 
-		cos =embedding.cosine(term.c_str() , iterator->first.c_str());
+		const int other = embedding.find(iterator->first.c_str());
+
+		cos = other == -1 ? 0 : embedding.similarity(id , other , threshold);
 
 		if( cos > threshold && term != iterator->first){
 
@@ -47,14 +52,19 @@ std::unordered_map<int,double> indexed_closest_terms(const std::string &term , c
 
 	std::unordered_map<int,double> most_sim;
 
-	if(embedding.get(term.c_str())==nullptr){return most_sim;}
+	//The id of term is only looked up once , the similarities are computed with the storage of the embedding (see Embedding::quantize)
+	const int id = embedding.find(term.c_str());
+
+	if(id == -1){return most_sim;}
 
 	float cos;
 
 	auto iterator = index.begin();
 	while(iterator != index.end()){
 
-		cos =embedding.cosine(term.c_str() , iterator->first.c_str());
+		const int other = embedding.find(iterator->first.c_str());
+
+		cos = other == -1 ? 0 : embedding.similarity(id , other , threshold);
 
 		if( cos > threshold && term != iterator->first){
 
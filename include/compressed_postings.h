@@ -0,0 +1,774 @@
+#ifndef compressed_postings_h
+#define compressed_postings_h
+
+#include "inverted_index.h"
+#include <cstring>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+//Number of postings of a full block ; the last block of a list can be shorter
+#define postings_block_size 128
+
+
+// Codec of the full blocks of postings (the last , shorter , block of a list is always stored with VByte)
+//   VBYTE       : 7 bits per byte , the high bit set on the last byte of a value
+//   PFOR_DELTA  : bit packing with the width that minimizes the size of the block , the values that do not fit are patched afterwards
+//   BIT_PACKING : bit packing with the width of the largest value of the block
+enum PostingsCodec { VBYTE , PFOR_DELTA , BIT_PACKING };
+
+
+//Number of bits needed to write value
+inline unsigned int bits_needed(uint32_t value){
+
+	unsigned int b = 0;
+	while(value != 0){b++; value >>= 1;}
+	return b;
+
+}
+
+
+void vbyte_encode(const uint32_t* values , const unsigned int n , std::vector<uint8_t> &out){
+
+	for(unsigned int i = 0 ; i < n ; i++){
+
+		uint32_t value = values[i];
+
+		while(value >= 128){
+
+			out.push_back(value & 127);
+			value >>= 7;
+
+		}
+
+		out.push_back(value | 128);
+
+	}
+
+}
+
+
+//Decode n values and return the position after them
+const uint8_t* vbyte_decode(const uint8_t* in , const unsigned int n , uint32_t* out){
+
+	for(unsigned int i = 0 ; i < n ; i++){
+
+		uint32_t value = 0;
+		unsigned int shift = 0;
+
+		while(!(*in & 128)){
+
+			value |= (uint32_t)(*in & 127) << shift;
+			shift += 7;
+			in++;
+
+		}
+
+		out[i] = value | ((uint32_t)(*in & 127) << shift);
+		in++;
+
+	}
+
+	return in;
+
+}
+
+
+// Bit packing of a full block of postings_block_size values on b bits , in 4 interleaved lanes : the value i is the (i/4)-th value of the lane i%4
+// and the words of the 4 lanes are interleaved , so that 4 consecutive words hold the same bits of 4 consecutive values and are unpacked together
+// with SSE2. A block takes 16*b bytes
+void pack_block(const uint32_t* values , const unsigned int b , std::vector<uint8_t> &out){
+
+	if(b == 0){return;}
+
+	std::vector<uint32_t> words(4*b , 0);
+
+	for(unsigned int i = 0 ; i < postings_block_size ; i++){
+
+		unsigned int lane = i % 4;
+		unsigned int bit = (i / 4)*b;
+		uint64_t value = b == 32 ? values[i] : values[i] & ((1u << b) - 1);
+
+		words[4*(bit / 32) + lane] |= (uint32_t)(value << (bit % 32));
+
+		if(bit % 32 + b > 32){words[4*(bit / 32 + 1) + lane] |= (uint32_t)(value >> (32 - bit % 32));}
+
+	}
+
+	size_t start = out.size();
+	out.resize(start + 4*b*sizeof(uint32_t));
+	std::memcpy(out.data() + start , words.data() , 4*b*sizeof(uint32_t));
+
+}
+
+
+//Unpack a block written by pack_block and return the position after it
+const uint8_t* unpack_block(const uint8_t* in , const unsigned int b , uint32_t* out){
+
+	if(b == 0){
+
+		std::fill(out , out + postings_block_size , 0);
+		return in;
+
+	}
+
+	if(b == 32){
+
+		//The lanes are already in the order of the values
+		std::memcpy(out , in , postings_block_size*sizeof(uint32_t));
+		return in + postings_block_size*sizeof(uint32_t);
+
+	}
+
+	const uint32_t mask = (1u << b) - 1;
+
+#ifdef __SSE2__
+	const __m128i masks = _mm_set1_epi32(mask);
+
+	for(unsigned int j = 0 ; j < postings_block_size/4 ; j++){
+
+		unsigned int bit = j*b;
+		unsigned int shift = bit % 32;
+
+		__m128i words = _mm_loadu_si128((const __m128i*)(in + 16*(bit / 32)));
+		__m128i value = _mm_srl_epi32(words , _mm_cvtsi32_si128(shift));
+
+		if(shift + b > 32){
+
+			__m128i next = _mm_loadu_si128((const __m128i*)(in + 16*(bit / 32 + 1)));
+			value = _mm_or_si128(value , _mm_sll_epi32(next , _mm_cvtsi32_si128(32 - shift)));
+
+		}
+
+		_mm_storeu_si128((__m128i*)(out + 4*j) , _mm_and_si128(value , masks));
+
+	}
+#else
+	uint32_t words[4*32];
+	std::memcpy(words , in , 4*b*sizeof(uint32_t));
+
+	for(unsigned int i = 0 ; i < postings_block_size ; i++){
+
+		unsigned int lane = i % 4;
+		unsigned int bit = (i / 4)*b;
+		uint32_t value = words[4*(bit / 32) + lane] >> (bit % 32);
+
+		if(bit % 32 + b > 32){value |= words[4*(bit / 32 + 1) + lane] << (32 - bit % 32);}
+
+		out[i] = value & mask;
+
+	}
+#endif
+
+	return in + 4*b*sizeof(uint32_t);
+
+}
+
+
+//Encode the n values of a block (n = postings_block_size except for the last block of a list)
+void encode_block(const PostingsCodec codec , const uint32_t* values , const unsigned int n , std::vector<uint8_t> &out){
+
+	if(codec == VBYTE || n < postings_block_size){
+
+		vbyte_encode(values , n , out);
+		return;
+
+	}
+
+	uint32_t largest = 0;
+	for(unsigned int i = 0 ; i < n ; i++){largest = std::max(largest , values[i]);}
+
+	unsigned int b = bits_needed(largest);
+
+	if(codec == BIT_PACKING){
+
+		out.push_back(b);
+		pack_block(values , b , out);
+		return;
+
+	}
+
+	//PForDelta : the width b that minimizes the packed values plus the exceptions (1 byte for the position , the high bits in VByte)
+	size_t best_size = std::numeric_limits<size_t>::max();
+	unsigned int best_b = b;
+
+	for(unsigned int width = 0 ; width <= b ; width++){
+
+		size_t size = 2 + 16*width;
+
+		for(unsigned int i = 0 ; i < n && size < best_size ; i++){
+
+			if(width < 32 && values[i] >> width != 0){size += 1 + (bits_needed(values[i] >> width) + 6)/7;}
+
+		}
+
+		if(size < best_size){
+
+			best_size = size;
+			best_b = width;
+
+		}
+
+	}
+
+	std::vector<uint8_t> positions;
+	std::vector<uint32_t> highs;
+	uint32_t low[postings_block_size];
+
+	for(unsigned int i = 0 ; i < n ; i++){
+
+		if(best_b < 32 && values[i] >> best_b != 0){
+
+			positions.push_back(i);
+			highs.push_back(values[i] >> best_b);
+
+		}
+
+		low[i] = best_b == 32 ? values[i] : values[i] & ((1u << best_b) - 1);
+
+	}
+
+	out.push_back(best_b);
+	out.push_back(positions.size());
+	pack_block(low , best_b , out);
+	out.insert(out.end() , positions.begin() , positions.end());
+	vbyte_encode(highs.data() , highs.size() , out);
+
+}
+
+
+//Decode the n values of a block written by encode_block into out (which must hold postings_block_size values) and return the position after the block
+const uint8_t* decode_block(const PostingsCodec codec , const uint8_t* in , const unsigned int n , uint32_t* out){
+
+	if(codec == VBYTE || n < postings_block_size){return vbyte_decode(in , n , out);}
+
+	unsigned int b = *in++;
+
+	if(codec == BIT_PACKING){return unpack_block(in , b , out);}
+
+	unsigned int nb_exceptions = *in++;
+
+	in = unpack_block(in , b , out);
+
+	const uint8_t* positions = in;
+	in += nb_exceptions;
+
+	uint32_t high;
+
+	for(unsigned int e = 0 ; e < nb_exceptions ; e++){
+
+		in = vbyte_decode(in , 1 , &high);
+		out[positions[e]] |= high << b;
+
+	}
+
+	return in;
+
+}
+
+
+
+class CompressedCandidateIterator;
+class CompressedCursor;
+
+
+// Postings lists of an inverted index compressed in blocks of postings_block_size postings : the docids as gaps (minus 1) and the tf minus 1 ,
+// each encoded with the codec. The skip data of a block is its last docid and its position , so that a cursor can pass over a block without
+// decoding it , with the largest tf , the largest tf/length ratio and the shortest document of the block for the Block-Max pruning (see pruning.h).
+// The lengths of the documents and the bounds used by the pruning are kept uncompressed
+class CompressedIndex {
+
+public:
+
+	typedef CompressedCandidateIterator candidate_iterator;
+
+	typedef CompressedCursor cursor;
+
+	CompressedIndex() : codec(VBYTE) {}
+
+	CompressedIndex(const InvertedIndex &inverted_index , const PostingsCodec codec){build(inverted_index , codec);}
+
+	void build(const InvertedIndex &inverted_index , const PostingsCodec codec);
+
+	PostingsCodec get_codec()const{return codec;}
+
+	size_t nb_terms()const{return sizes.size();}
+
+	size_t nb_docs()const{return ids.size();}
+
+	size_t postings_size(const int term)const{return (term < 0 || term >= (int)nb_terms()) ? 0 : sizes[term];}
+
+	int max_tf(const int term)const{return postings_size(term) == 0 ? 0 : max_tfs[term];}
+
+	double max_tf_ratio(const int term)const{return postings_size(term) == 0 ? 0 : max_ratios[term];}
+
+	//Return the tf of term in the document doc (0 if the document does not contain it) , only its block is decoded
+	int tf(const int term , const int doc)const;
+
+	int doc_length(const int doc)const{return lengths[doc];}
+
+	const std::vector<int>& doc_ids()const{return ids;}
+
+	const std::vector<int>& docs_by_length()const{return sorted_by_length;}
+
+	//First block of term
+	size_t first_block(const int term)const{return term_blocks[term];}
+
+	//Last docid of the block
+	int block_last_doc(const size_t block)const{return last_docs[block];}
+
+	//Largest tf , largest tf/length ratio and shortest document of the block
+	int block_max_tf(const size_t block)const{return block_max_tfs[block];}
+
+	double block_max_ratio(const size_t block)const{return block_max_ratios[block];}
+
+	int block_min_length(const size_t block)const{return block_min_lengths[block];}
+
+	//Decode the docids and the tfs of a block of n postings , previous_doc being the last docid of the previous block of the list (-1 for the first one)
+	void decode(const size_t block , const unsigned int n , const int previous_doc , uint32_t* docs , uint32_t* tfs)const;
+
+	//Decode only the docids of a block , return the position of its tfs
+	const uint8_t* decode_docs(const size_t block , const unsigned int n , const int previous_doc , uint32_t* docs)const;
+
+	//Decode the tfs of a block from the position returned by decode_docs
+	void decode_tfs(const uint8_t* position , const unsigned int n , uint32_t* tfs)const;
+
+	//Size of the compressed postings and of the skip data in bytes
+	size_t size_in_bytes()const{return bytes.size() + last_docs.size()*(2*sizeof(int) + sizeof(uint64_t) + sizeof(int) + sizeof(double));}
+
+	//Total number of postings
+	size_t nb_postings()const{return total;}
+
+
+private:
+
+	PostingsCodec codec;
+
+	std::vector<size_t> term_blocks;
+
+	std::vector<int> sizes;
+
+	std::vector<int> last_docs;
+
+	std::vector<uint64_t> block_offsets;
+
+	std::vector<int> block_max_tfs;
+
+	std::vector<double> block_max_ratios;
+
+	std::vector<int> block_min_lengths;
+
+	std::vector<uint8_t> bytes;
+
+	std::vector<int> max_tfs;
+
+	std::vector<double> max_ratios;
+
+	std::vector<int> lengths;
+
+	std::vector<int> ids;
+
+	std::vector<int> sorted_by_length;
+
+	size_t total;
+
+};
+
+
+void CompressedIndex::build(const InvertedIndex &inverted_index , const PostingsCodec codec){
+
+	this->codec = codec;
+
+	size_t nb = inverted_index.nb_terms();
+
+	term_blocks.assign(1 , 0);
+	sizes.assign(nb , 0);
+	max_tfs.assign(nb , 0);
+	max_ratios.assign(nb , 0);
+	last_docs.clear();
+	block_offsets.clear();
+	block_max_tfs.clear();
+	block_max_ratios.clear();
+	block_min_lengths.clear();
+	bytes.clear();
+	total = 0;
+
+	uint32_t gaps[postings_block_size];
+	uint32_t frequencies[postings_block_size];
+
+	for(unsigned int t = 0 ; t < nb ; t++){
+
+		const int* docs = inverted_index.docs(t);
+		const int* tfs = inverted_index.tfs(t);
+		size_t size = inverted_index.postings_size(t);
+
+		sizes[t] = size;
+		max_tfs[t] = inverted_index.max_tf(t);
+		max_ratios[t] = inverted_index.max_tf_ratio(t);
+		total += size;
+
+		int previous_doc = -1;
+
+		for(size_t start = 0 ; start < size ; start += postings_block_size){
+
+			unsigned int n = std::min(size - start , (size_t)postings_block_size);
+
+			int max_tf = 0;
+			double max_ratio = 0;
+			int min_length = std::numeric_limits<int>::max();
+
+			for(unsigned int i = 0 ; i < n ; i++){
+
+				gaps[i] = docs[start + i] - previous_doc - 1;
+				frequencies[i] = tfs[start + i] - 1;
+				previous_doc = docs[start + i];
+
+				int length = inverted_index.doc_length(docs[start + i]);
+
+				max_tf = std::max(max_tf , tfs[start + i]);
+				max_ratio = std::max(max_ratio , (double)tfs[start + i]/length);
+				min_length = std::min(min_length , length);
+
+			}
+
+			block_offsets.push_back(bytes.size());
+			last_docs.push_back(previous_doc);
+			block_max_tfs.push_back(max_tf);
+			block_max_ratios.push_back(max_ratio);
+			block_min_lengths.push_back(min_length);
+
+			encode_block(codec , gaps , n , bytes);
+			encode_block(codec , frequencies , n , bytes);
+
+		}
+
+		term_blocks.push_back(last_docs.size());
+
+	}
+
+	//Padding so that the SSE2 loads of the last block stay in the array
+	bytes.resize(bytes.size() + 16 , 0);
+
+	ids = inverted_index.doc_ids();
+	lengths.assign(ids.size() == 0 ? 0 : ids.back() + 1 , 0);
+	for(unsigned int i = 0 ; i < ids.size() ; i++){lengths[ids[i]] = inverted_index.doc_length(ids[i]);}
+	sorted_by_length = inverted_index.docs_by_length();
+
+}
+
+
+const uint8_t* CompressedIndex::decode_docs(const size_t block , const unsigned int n , const int previous_doc , uint32_t* docs)const{
+
+	const uint8_t* position = decode_block(codec , bytes.data() + block_offsets[block] , n , docs);
+
+	uint32_t doc = previous_doc;
+
+	for(unsigned int i = 0 ; i < n ; i++){
+
+		doc += docs[i] + 1;
+		docs[i] = doc;
+
+	}
+
+	return position;
+
+}
+
+
+void CompressedIndex::decode_tfs(const uint8_t* position , const unsigned int n , uint32_t* tfs)const{
+
+	decode_block(codec , position , n , tfs);
+
+	for(unsigned int i = 0 ; i < n ; i++){tfs[i]++;}
+
+}
+
+
+int CompressedIndex::tf(const int term , const int doc)const{
+
+	size_t size = postings_size(term);
+
+	if(size == 0){return 0;}
+
+	size_t first = term_blocks[term];
+	size_t last = term_blocks[term + 1];
+	size_t block = std::lower_bound(last_docs.begin() + first , last_docs.begin() + last , doc) - last_docs.begin();
+
+	if(block == last){return 0;}
+
+	unsigned int n = std::min(size - (block - first)*postings_block_size , (size_t)postings_block_size);
+
+	uint32_t docs[postings_block_size];
+	uint32_t tfs[postings_block_size];
+
+	decode(block , n , block == first ? -1 : last_docs[block - 1] , docs , tfs);
+
+	uint32_t* p = std::lower_bound(docs , docs + n , (uint32_t)doc);
+
+	if(p == docs + n || *p != (uint32_t)doc){return 0;}
+
+	return tfs[p - docs];
+
+}
+
+
+void CompressedIndex::decode(const size_t block , const unsigned int n , const int previous_doc , uint32_t* docs , uint32_t* tfs)const{
+
+	decode_tfs(decode_docs(block , n , previous_doc , docs) , n , tfs);
+
+}
+
+
+
+// Reads the compressed postings list of one term block by block , with the interface of PostingsCursor. The skip data lets next_geq pass over
+// the blocks whose last docid is lower than the target without decoding them , and the tfs of a block are only decoded when one is read
+class CompressedCursor {
+
+public:
+
+	CompressedCursor(const CompressedIndex &compressed_index , const int term);
+
+	bool at_end()const{return position >= size;}
+
+	int doc()const{return at_end() ? std::numeric_limits<int>::max() : (int)docs[position - block_start];}
+
+	int tf()const;
+
+	void next();
+
+	//Move to the first posting whose docid is greater or equal to target and return the number of postings passed over
+	size_t next_geq(const int target);
+
+	size_t length()const{return size;}
+
+	//Move the block used by the accessors below to the first block whose last docid is greater or equal to target , without decoding it
+	//nor moving the cursor (the block of the cursor is used if it is already further)
+	void shallow_next_geq(const int target);
+
+	//Block reached by the shallow moves
+	size_t current_block()const{return shallow;}
+
+	int block_last_doc()const{return compressed_index->block_last_doc(shallow);}
+
+	int block_max_tf()const{return compressed_index->block_max_tf(shallow);}
+
+	double block_max_ratio()const{return compressed_index->block_max_ratio(shallow);}
+
+	int block_min_length()const{return compressed_index->block_min_length(shallow);}
+
+
+private:
+
+	//Decode the docids of the block that holds position
+	void load_block();
+
+	//Last block of the list
+	size_t last_block()const{return first + (size - 1) / postings_block_size;}
+
+	const CompressedIndex* compressed_index;
+
+	size_t first;
+
+	size_t size;
+
+	size_t position;
+
+	//Block loaded , its first posting and its number of postings
+	size_t block;
+
+	//Block of the shallow moves
+	size_t shallow;
+
+	size_t block_start;
+
+	unsigned int block_size;
+
+	const uint8_t* tfs_position;
+
+	mutable bool tfs_decoded;
+
+	uint32_t docs[postings_block_size];
+
+	mutable uint32_t tfs[postings_block_size];
+
+};
+
+
+CompressedCursor::CompressedCursor(const CompressedIndex &compressed_index , const int term) : compressed_index(&compressed_index) , first(0) , size(compressed_index.postings_size(term)) , position(0) , block(0) , shallow(0) , block_start(0) , block_size(0) , tfs_position(nullptr) , tfs_decoded(false) {
+
+	if(size == 0){return;}
+
+	first = compressed_index.first_block(term);
+	block = first;
+	shallow = first;
+	load_block();
+
+}
+
+
+void CompressedCursor::load_block(){
+
+	block = first + position / postings_block_size;
+	block_start = (block - first)*postings_block_size;
+	block_size = std::min(size - block_start , (size_t)postings_block_size);
+
+	int previous_doc = block == first ? -1 : compressed_index->block_last_doc(block - 1);
+
+	tfs_position = compressed_index->decode_docs(block , block_size , previous_doc , docs);
+	tfs_decoded = false;
+
+}
+
+
+void CompressedCursor::shallow_next_geq(const int target){
+
+	if(size == 0){return;}
+
+	size_t last = last_block();
+
+	shallow = std::max(shallow , block);
+
+	while(shallow < last && compressed_index->block_last_doc(shallow) < target){shallow++;}
+
+}
+
+
+int CompressedCursor::tf()const{
+
+	if(!tfs_decoded){
+
+		compressed_index->decode_tfs(tfs_position , block_size , tfs);
+		tfs_decoded = true;
+
+	}
+
+	return tfs[position - block_start];
+
+}
+
+
+void CompressedCursor::next(){
+
+	position++;
+
+	if(!at_end() && position - block_start >= block_size){load_block();}
+
+}
+
+
+size_t CompressedCursor::next_geq(const int target){
+
+	size_t start = position;
+
+	if(at_end() || doc() >= target){return 0;}
+
+	//Blocks skipped with their last docid , from the block of the last shallow move if the target is after it
+	size_t last = last_block();
+	size_t current = block;
+
+	if(shallow > block && compressed_index->block_last_doc(shallow - 1) < target){current = shallow;}
+
+	while(current < last && compressed_index->block_last_doc(current) < target){current++;}
+
+	if(current != block){
+
+		position = (current - first)*postings_block_size;
+		load_block();
+
+	}
+
+	while(!at_end() && (int)docs[position - block_start] < target){
+
+		position++;
+
+		if(!at_end() && position - block_start >= block_size){load_block();}
+
+	}
+
+	return position - start;
+
+}
+
+
+
+// Candidate documents of a query over a compressed index , with the interface of CandidateIterator
+class CompressedCandidateIterator {
+
+public:
+
+	CompressedCandidateIterator(const std::vector<int> &query , const CompressedIndex &compressed_index);
+
+	bool next();
+
+	int doc()const{return current;}
+
+	const std::vector<int>& tfs()const{return frequencies;}
+
+
+private:
+
+	std::vector<CompressedCursor> cursors;
+
+	//Position in the query of the term of each cursor
+	std::vector<int> positions;
+
+	std::vector<int> frequencies;
+
+	int current;
+
+};
+
+
+CompressedCandidateIterator::CompressedCandidateIterator(const std::vector<int> &query , const CompressedIndex &compressed_index) : frequencies(query.size() , 0) , current(-1) {
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		if(compressed_index.postings_size(query[i]) > 0){
+
+			cursors.push_back(CompressedCursor(compressed_index , query[i]));
+			positions.push_back(i);
+
+		}
+
+	}
+
+}
+
+
+bool CompressedCandidateIterator::next(){
+
+	current = std::numeric_limits<int>::max();
+
+	for(unsigned int j = 0 ; j < cursors.size() ; j++){current = std::min(current , cursors[j].doc());}
+
+	if(current == std::numeric_limits<int>::max()){
+
+		current = -1;
+		return false;
+
+	}
+
+	for(unsigned int j = 0 ; j < cursors.size() ; j++){
+
+		frequencies[positions[j]] = 0;
+
+		if(cursors[j].doc() == current){
+
+			frequencies[positions[j]] = cursors[j].tf();
+			cursors[j].next();
+
+		}
+
+	}
+
+	return true;
+
+}
+
+
+#endif
@@ -4,15 +4,24 @@
 
 #include "frequency.h"
 #include "tool.h"
+#include "inverted_index.h"
+#include "compressed_postings.h"
+#include "pruning.h"
+#include "translated_index.h"
+#include "accumulator.h"
+#include "sharded_index.h"
 #include <cstring>
+#include <cassert>
 #include <vector>
 #include <unordered_map>
 //#include <algorithm>
 
 
 //Computes the log of the probability that query was generated by the document w.r.t dirichlet language model pdir(query | document)
+//The document is a std::vector<int> or a DocumentView
+template<typename Document>
 inline
-double Dirichlet_language_model(const double &mu , const std::vector<int> &query , const std::vector<int> &document , const std::unordered_map <int,int>  &cf , const int collection_size){
+double Dirichlet_language_model(const double &mu , const std::vector<int> &query , const Document &document , const std::unordered_map <int,int>  &cf , const int collection_size){
 
 	if(document.size()==0){return 0;}
 
@@ -81,15 +90,57 @@ std::vector< std::vector< std::pair<int,double> > > Dirichlet_language_model(con
 
 	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
 
-	auto iterator = queries.begin();
+	std::vector<int> query_ids = queries_by_length(queries);
 
-	while(iterator != queries.end()){
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
 
 		//std::cout<<"\rProcessing query "<<i+1<<"/"<<queries.size()<<std::flush;
 
 		list_docs[iterator->first] =  kfirst_docs( Dirichlet_language_model(mu , iterator->second , collection , cf , collection_size) , k );
 
-		iterator++;
+	}
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but over a document store , whose documents are read in docid order
+std::unordered_map <int,double> Dirichlet_language_model(const double &mu , const std::vector<int> &query , const DocumentStore &documents , const std::unordered_map <int,int>  &cf , const int collection_size ){
+
+	std::unordered_map <int,double> list_doc;
+
+	double proba;
+
+	for(unsigned int i = 0 ; i < documents.nb_docs() ; i++){
+
+		proba = Dirichlet_language_model(mu , query , documents.document(i) , cf , collection_size);
+		if(proba!=0){list_doc[documents.id(i)]=proba;}
+
+	}
+
+	return list_doc;
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_language_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const DocumentStore &documents , const std::unordered_map <int,int>  &cf , const int k , const int collection_size){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		list_docs[iterator->first] =  kfirst_docs( Dirichlet_language_model(mu , iterator->second , documents , cf , collection_size) , k );
 
 	}
 
@@ -99,86 +150,1256 @@ std::vector< std::vector< std::pair<int,double> > > Dirichlet_language_model(con
 
 
 
-//Computes the log of the probability that query was generated by the document w.r.t dirichlet language model  pdir(query | document)
-double Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const std::vector<int> &document , const std::unordered_map <int,int>  &cf , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const int collection_size , const double &alpha ){
+//Same as before but over a forward index : the tf of every term of the query is found with a binary search in the distinct terms of the document
+std::unordered_map <int,double> Dirichlet_language_model(const double &mu , const std::vector<int> &query , const ForwardIndex &forward_index , const std::unordered_map <int,int>  &cf , const int collection_size ){
 
-	double res = 0;
+	std::unordered_map <int,double> list_doc;
 
 	double proba;
 
+	for(unsigned int i = 0 ; i < forward_index.nb_docs() ; i++){
+
+		proba = Dirichlet_language_model(mu , query , forward_index.document(i) , cf , collection_size);
+		if(proba!=0){list_doc[forward_index.id(i)]=proba;}
+
+	}
+
+	return list_doc;
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_language_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const ForwardIndex &forward_index , const std::unordered_map <int,int>  &cf , const int k , const int collection_size){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		list_docs[iterator->first] =  kfirst_docs( Dirichlet_language_model(mu , iterator->second , forward_index , cf , collection_size) , k );
+
+	}
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but from the tf of each term of the query in the document and the length of the document
+inline
+double Dirichlet_language_model(const double &mu , const std::vector<int> &query , const std::vector<int> &tfs , const int doc_length , const std::unordered_map <int,int>  &cf , const int collection_size){
+
+	if(doc_length==0){return 0;}
+
+	double res = 0;
+
 	int collection_freq;
 
 	for(unsigned int i = 0 ; i < query.size() ; i++){
 
-		proba = proba_doc_generate_term(query[i] , document , sum_cosine_map , cosine_map , alpha);
-
 		collection_freq = coll_freq(cf , query[i]);
 
-		if(collection_freq != 0 && proba != 0){
+		if(collection_freq != 0){
 
-			res += log( ( (proba*document.size()) + mu*((double)collection_freq/collection_size))/(document.size() + mu) );
+			res += log( ( tfs[i] + mu*((double)collection_freq/collection_size))/(doc_length + mu) );
 
 		}
 
-		else if(collection_freq != 0 && proba == 0){
+	}
 
-			res += log((double)collection_freq/collection_size );
+	return res;
+
+}
+
+
+
+//Same as before but over the entire collection using the inverted index : only the documents that contain a term of the query are read.
+//The other documents only get the background part of the score, which decreases with their length, so only the k shortest of them can be in the top k.
+//The documents are pushed into collector , which keeps the k best of them (k being the capacity of the collector).
+//Index is an InvertedIndex or a CompressedIndex
+template<typename Index>
+void Dirichlet_language_model(const double &mu , const std::vector<int> &query , const Index &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , TopkCollector &collector){
+
+	bool scored_term = false;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		if(coll_freq(cf , query[i]) != 0){scored_term = true;}
+
+	}
+
+	if(!scored_term){return;}
+
+	double proba;
+
+	std::vector<int> matched;
+
+	typename Index::candidate_iterator candidates(query , inverted_index);
+
+	while(candidates.next()){
+
+		matched.push_back(candidates.doc());
+		proba = Dirichlet_language_model(mu , query , candidates.tfs() , inverted_index.doc_length(candidates.doc()) , cf , collection_size);
+		if(proba!=0){collector.push(candidates.doc() , proba);}
+
+	}
+
+	const std::vector<int> &by_length = inverted_index.docs_by_length();
+
+	std::vector<int> no_tfs(query.size() , 0);
+
+	const int k = collector.capacity();
+
+	int nb_background = 0;
+
+	for(unsigned int i = 0 ; i < by_length.size() && (k == -1 || nb_background < k) ; i++){
+
+		//matched is sorted since the candidates come in increasing docid order
+		if(std::binary_search(matched.begin() , matched.end() , by_length[i])){continue;}
+
+		proba = Dirichlet_language_model(mu , query , no_tfs , inverted_index.doc_length(by_length[i]) , cf , collection_size);
+
+		//The next documents are longer so none of them can enter the top k
+		if(proba < collector.threshold()){break;}
+
+		if(proba!=0){collector.push(by_length[i] , proba);}
+		nb_background++;
+
+	}
+
+}
+
+
+//Same as before but the scores of the k best documents are returned in a map
+std::unordered_map <int,double> Dirichlet_language_model(const double &mu , const std::vector<int> &query , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k){
+
+	TopkCollector collector(k);
+
+	Dirichlet_language_model(mu , query , inverted_index , cf , collection_size , collector);
+
+	return collector.scores();
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_language_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const int k , const int collection_size){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel
+	{
+
+		//Every thread has its own collector and reuses it for its queries
+		TopkCollector collector(k);
+
+		#pragma omp for schedule(dynamic)
+		for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+			auto iterator = queries.find(query_ids[q]);
+
+			collector.reset();
+			Dirichlet_language_model(mu , iterator->second , inverted_index , cf , collection_size , collector);
+			list_docs[iterator->first] = collector.results();
 
 		}
 
-		else if(collection_freq == 0 && proba != 0){
+	}
 
-			res += log( proba );
+	return list_docs;
+
+}
+
+
+
+//Same as before but over a sharded index : the shards are searched in parallel and their k best documents are merged (see sharded_index.h).
+//cf and collection_size are the statistics of the whole collection , so the scores are the same as over a single inverted index
+std::vector< std::pair<int,double> > Dirichlet_language_model(const double &mu , const std::vector<int> &query , const ShardedIndex &sharded_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k){
+
+	return sharded_top_k(sharded_index , [&](const InvertedIndex &shard , TopkCollector &collector){Dirichlet_language_model(mu , query , shard , cf , collection_size , collector);} , k);
+
+}
+
+
+//Same as before but with all the queries : when there are fewer queries than threads every query is searched by all the threads (one shard each) ,
+//otherwise the queries are shared between the threads and the shards of a query are searched one after the other
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_language_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const ShardedIndex &sharded_index , const std::unordered_map <int,int>  &cf , const int k , const int collection_size){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	bool parallel_queries = (int)query_ids.size() >= available_threads();
+
+	#pragma omp parallel for schedule(dynamic) if(parallel_queries)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		list_docs[query_ids[q]] = Dirichlet_language_model(mu , queries.at(query_ids[q]) , sharded_index , cf , collection_size , k);
+
+	}
+
+	return list_docs;
+
+}
+
+
+// Bounds of the Dirichlet score for the dynamic pruning (see pruning.h) , using that
+// log( (tf + mu*p)/(|d| + mu) ) = log( mu*p/(|d| + mu) ) + log( 1 + tf/(mu*p) )
+// The first part only depends on the length of the document , the second one is bounded by the largest tf of the term (in the list or in a block)
+class DirichletBounds {
+
+public:
+
+	template<typename Index>
+	DirichletBounds(const double &mu , const std::vector<int> &query , const Index &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k);
+
+	//Return true if at least one term of the query is in the collection
+	bool has_scored_term()const{return nb_scored_terms > 0;}
+
+	bool active(const int i)const{return collection_proba[i] != 0;}
+
+	double bound(const int i)const{return bounds[i];}
+
+	double increment(const int i , const int tf , const int)const{return log(1 + tf/(mu*collection_proba[i]));}
+
+	double block_bound(const int i , const int max_tf , const double)const{return log(1 + max_tf/(mu*collection_proba[i]));}
+
+	double doc_bound(const int doc_length)const{return sum_log_background - nb_scored_terms*log(doc_length + mu);}
+
+	double max_doc_bound()const{return max_background;}
+
+	double initial_threshold()const{return threshold;}
+
+	double score(const std::vector<int> &tfs , const int doc_length)const{return Dirichlet_language_model(mu , query , tfs , doc_length , cf , collection_size);}
+
+
+private:
+
+	double mu;
+
+	const std::vector<int> &query;
+
+	const std::unordered_map <int,int>  &cf;
+
+	int collection_size;
+
+	std::vector<double> collection_proba;
+
+	std::vector<double> bounds;
+
+	int nb_scored_terms;
+
+	double sum_log_background;
+
+	double max_background;
+
+	double threshold;
+
+};
+
+
+template<typename Index>
+DirichletBounds::DirichletBounds(const double &mu , const std::vector<int> &query , const Index &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k) : mu(mu) , query(query) , cf(cf) , collection_size(collection_size) , collection_proba(query.size() , 0) , bounds(query.size() , 0) , nb_scored_terms(0) , sum_log_background(0) , max_background(0) , threshold(-std::numeric_limits<double>::infinity()) {
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		if(coll_freq(cf , query[i]) != 0){
+
+			collection_proba[i] = (double)coll_freq(cf , query[i])/collection_size;
+			bounds[i] = log(1 + inverted_index.max_tf(query[i])/(mu*collection_proba[i]));
+			sum_log_background += log(mu*collection_proba[i]);
+			nb_scored_terms++;
 
 		}
 
 	}
 
-	return res;
+	const std::vector<int> &by_length = inverted_index.docs_by_length();
+
+	if(by_length.size() > 0){
+
+		max_background = doc_bound(inverted_index.doc_length(by_length[0]));
+
+		//The k shortest documents score at least the background part of the k-th one
+		if(k > 0 && k <= (int)by_length.size()){threshold = doc_bound(inverted_index.doc_length(by_length[k-1]));}
+
+	}
 
 }
 
 
 
-//Same as before but over the entire collection
-std::unordered_map <int,double> Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const std::unordered_map< int , std::vector<int> > &collection , const std::unordered_map <int,int>  &cf , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const int collection_size , const double &alpha){
+//Same as before but only the k best documents are returned , sorted by decreasing score.
+//The documents that cannot enter the top k are skipped with the MaxScore , WAND or Block-Max WAND strategy , the number of documents scored and of postings skipped are added to counters
+template<typename Index>
+std::vector< std::pair<int,double> > Dirichlet_language_model(const double &mu , const std::vector<int> &query , const Index &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k , const PruningStrategy strategy , PruningCounters &counters){
 
-	std::unordered_map <int,double> list_doc;
+	if(k == -1){
+
+		TopkCollector collector(k);
+		Dirichlet_language_model(mu , query , inverted_index , cf , collection_size , collector);
+		return collector.results();
+
+	}
+
+	DirichletBounds scorer(mu , query , inverted_index , cf , collection_size , k);
+
+	if(!scorer.has_scored_term()){return std::vector< std::pair<int,double> >();}
+
+	TopkCollector collector(k);
+
+	pruned_top_k(query , inverted_index , scorer , collector , strategy , counters);
+
+	//Documents that contain no term of the query , by decreasing background score
+	const std::vector<int> &by_length = inverted_index.docs_by_length();
+
+	std::vector<int> no_tfs(query.size() , 0);
 
 	double proba;
 
-	auto iterator = collection.begin();
+	for(unsigned int i = 0 ; i < by_length.size() ; i++){
 
-	while( iterator != collection.end() ){
+		proba = Dirichlet_language_model(mu , query , no_tfs , inverted_index.doc_length(by_length[i]) , cf , collection_size);
 
-		proba = Dirichlet_embedding_model(mu , query , iterator->second , cf , sum_cosine_map , cosine_map , collection_size , alpha );
-		if(proba!=0){list_doc[iterator->first]=proba;}
+		if(collector.full() && proba < collector.threshold()){break;}
 
-		iterator++;
+		bool matched = false;
+
+		for(unsigned int j = 0 ; j < query.size() && !matched ; j++){
+
+			if(scorer.active(j) && inverted_index.tf(query[j] , by_length[i]) != 0){matched = true;}
+
+		}
+
+		if(!matched && proba!=0){collector.push(by_length[i] , proba);}
 
 	}
 
-	return list_doc;
+	return collector.results();
 
 }
 
 
-//Same as before but with all the queries and sort documents by their score
-std::vector< std::vector< std::pair<int,double> > > Dirichlet_embedding_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const std::unordered_map< int , std::vector<int> > &collection , const std::unordered_map <int,int>  &cf , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const int k , const int collection_size , const double &alpha ){
+//Same as before but with all the queries , counters[q] gets the pruning counters of the query q
+template<typename Index>
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_language_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const Index &inverted_index , const std::unordered_map <int,int>  &cf , const int k , const int collection_size , const PruningStrategy strategy , std::vector<PruningCounters> &counters){
 
 	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
 
-	auto iterator = queries.begin();
+	counters.assign(queries.size() , PruningCounters());
 
-	while(iterator != queries.end() ){
+	std::vector<int> query_ids = queries_by_length(queries);
 
-		list_docs[iterator->first] = kfirst_docs( Dirichlet_embedding_model(mu , iterator->second , collection , cf , sum_cosine_map , cosine_map , collection_size , alpha ) , k );
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
 
-		iterator++;
+		auto iterator = queries.find(query_ids[q]);
+
+		list_docs[iterator->first] = Dirichlet_language_model(mu , iterator->second , inverted_index , cf , collection_size , k , strategy , counters[iterator->first]);
 
 	}
 
-	std::cout<<std::endl;
+	return list_docs;
+
+}
+
+
+
+//Same as before but for several values of mu at once : the postings lists of the query are read only once and
+//every candidate is scored for all the values of mu. list_docs[p] gets the k best documents for mus[p] , sorted by decreasing score
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_language_model(const std::vector<double> &mus , const std::vector<int> &query , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k){
+
+	std::vector<TopkCollector> collectors(mus.size() , TopkCollector(k));
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(mus.size());
+
+	//Collection probability of the terms of the query that are in the collection
+	std::vector<double> collection_proba;
+	std::vector<int> positions;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		if(coll_freq(cf , query[i]) != 0){
+
+			collection_proba.push_back((double)coll_freq(cf , query[i])/collection_size);
+			positions.push_back(i);
+
+		}
+
+	}
+
+	if(positions.size() == 0){return list_docs;}
+
+	double proba;
+
+	int doc_length;
+
+	std::vector<int> matched;
+
+	CandidateIterator candidates(query , inverted_index);
+
+	while(candidates.next()){
+
+		matched.push_back(candidates.doc());
+		doc_length = inverted_index.doc_length(candidates.doc());
+
+		if(doc_length == 0){continue;}
+
+		for(unsigned int p = 0 ; p < mus.size() ; p++){
+
+			proba = 0;
+
+			for(unsigned int j = 0 ; j < positions.size() ; j++){
+
+				proba += log( ( candidates.tfs()[positions[j]] + mus[p]*collection_proba[j])/(doc_length + mus[p]) );
+
+			}
+
+			if(proba!=0){collectors[p].push(candidates.doc() , proba);}
+
+		}
+
+	}
+
+	//The documents without any term of the query are ranked by length whatever mu is , so the k shortest of them are the same for every mu
+	const std::vector<int> &by_length = inverted_index.docs_by_length();
+
+	int nb_background = 0;
+
+	for(unsigned int i = 0 ; i < by_length.size() && (k == -1 || nb_background < k) ; i++){
+
+		if(std::binary_search(matched.begin() , matched.end() , by_length[i])){continue;}
+
+		doc_length = inverted_index.doc_length(by_length[i]);
+
+		for(unsigned int p = 0 ; p < mus.size() ; p++){
+
+			proba = 0;
+
+			for(unsigned int j = 0 ; j < positions.size() ; j++){
+
+				proba += log( mus[p]*collection_proba[j]/(doc_length + mus[p]) );
+
+			}
+
+			if(proba!=0){collectors[p].push(by_length[i] , proba);}
+
+		}
+
+		nb_background++;
+
+	}
+
+	for(unsigned int p = 0 ; p < mus.size() ; p++){list_docs[p] = collectors[p].results();}
+
+	return list_docs;
+
+}
+
+
+//Same as before but with all the queries : list_docs[p][q] gets the k best documents of the query q for mus[p]
+std::vector< std::vector< std::vector< std::pair<int,double> > > > Dirichlet_language_model(const std::vector<double> &mus , const std::unordered_map< int , std::vector<int> > &queries , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const int k , const int collection_size){
+
+	std::vector< std::vector< std::vector< std::pair<int,double> > > > list_docs(mus.size() , std::vector< std::vector< std::pair<int,double> > >(queries.size()));
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		std::vector< std::vector< std::pair<int,double> > > temp = Dirichlet_language_model(mus , iterator->second , inverted_index , cf , collection_size , k);
+
+		for(unsigned int p = 0 ; p < mus.size() ; p++){list_docs[p][iterator->first].swap(temp[p]);}
+
+	}
+
+	return list_docs;
+
+}
+
+
+
+//Computes the log of the probability that query was generated by the document w.r.t dirichlet language model  pdir(query | document)
+template<typename Document>
+double Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const Document &document , const std::unordered_map <int,int>  &cf , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const int collection_size , const double &alpha ){
+
+	double res = 0;
+
+	double proba;
+
+	int collection_freq;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		proba = proba_doc_generate_term(query[i] , document , sum_cosine_map , cosine_map , alpha);
+
+		collection_freq = coll_freq(cf , query[i]);
+
+		if(collection_freq != 0 && proba != 0){
+
+			res += log( ( (proba*document.size()) + mu*((double)collection_freq/collection_size))/(document.size() + mu) );
+
+		}
+
+		else if(collection_freq != 0 && proba == 0){
+
+			res += log((double)collection_freq/collection_size );
+
+		}
+
+		else if(collection_freq == 0 && proba != 0){
+
+			res += log( proba );
+
+		}
+
+	}
+
+	return res;
+
+}
+
+
+
+//Same as before but over the entire collection
+std::unordered_map <int,double> Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const std::unordered_map< int , std::vector<int> > &collection , const std::unordered_map <int,int>  &cf , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const int collection_size , const double &alpha){
+
+	std::unordered_map <int,double> list_doc;
+
+	double proba;
+
+	auto iterator = collection.begin();
+
+	while( iterator != collection.end() ){
+
+		proba = Dirichlet_embedding_model(mu , query , iterator->second , cf , sum_cosine_map , cosine_map , collection_size , alpha );
+		if(proba!=0){list_doc[iterator->first]=proba;}
+
+		iterator++;
+
+	}
+
+	return list_doc;
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_embedding_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const std::unordered_map< int , std::vector<int> > &collection , const std::unordered_map <int,int>  &cf , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const int k , const int collection_size , const double &alpha ){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		list_docs[iterator->first] = kfirst_docs( Dirichlet_embedding_model(mu , iterator->second , collection , cf , sum_cosine_map , cosine_map , collection_size , alpha ) , k );
+
+	}
+
+	std::cout<<std::endl;
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but over a document store , whose documents are read in docid order
+std::unordered_map <int,double> Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const DocumentStore &documents , const std::unordered_map <int,int>  &cf , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const int collection_size , const double &alpha){
+
+	std::unordered_map <int,double> list_doc;
+
+	double proba;
+
+	for(unsigned int i = 0 ; i < documents.nb_docs() ; i++){
+
+		proba = Dirichlet_embedding_model(mu , query , documents.document(i) , cf , sum_cosine_map , cosine_map , collection_size , alpha );
+		if(proba!=0){list_doc[documents.id(i)]=proba;}
+
+	}
+
+	return list_doc;
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_embedding_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const DocumentStore &documents , const std::unordered_map <int,int>  &cf , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const int k , const int collection_size , const double &alpha ){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		list_docs[iterator->first] = kfirst_docs( Dirichlet_embedding_model(mu , iterator->second , documents , cf , sum_cosine_map , cosine_map , collection_size , alpha ) , k );
+
+	}
+
+	return list_docs;
+
+}
+
+
+//Computes the log of the probability that query was generated by the document w.r.t dirichlet language model  pdir(query | document) , with the translation probabilities read from the translation matrix
+template<typename Document>
+double Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const Document &document , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int collection_size , const double &alpha ){
+
+	double res = 0;
+
+	double proba;
+
+	int collection_freq;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		proba = proba_doc_generate_term(query[i] , document , translation_matrix , alpha);
+
+		collection_freq = coll_freq(cf , query[i]);
+
+		if(collection_freq != 0 && proba != 0){
+
+			res += log( ( (proba*document.size()) + mu*((double)collection_freq/collection_size))/(document.size() + mu) );
+
+		}
+
+		else if(collection_freq != 0 && proba == 0){
+
+			res += log((double)collection_freq/collection_size );
+
+		}
+
+		else if(collection_freq == 0 && proba != 0){
+
+			res += log( proba );
+
+		}
+
+	}
+
+	return res;
+
+}
+
+
+
+//Same as before but over the entire collection
+std::unordered_map <int,double> Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const std::unordered_map< int , std::vector<int> > &collection , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int collection_size , const double &alpha){
+
+	std::unordered_map <int,double> list_doc;
+
+	double proba;
+
+	auto iterator = collection.begin();
+
+	while( iterator != collection.end() ){
+
+		proba = Dirichlet_embedding_model(mu , query , iterator->second , cf , translation_matrix , collection_size , alpha );
+		if(proba!=0){list_doc[iterator->first]=proba;}
+
+		iterator++;
+
+	}
+
+	return list_doc;
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_embedding_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const std::unordered_map< int , std::vector<int> > &collection , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int k , const int collection_size , const double &alpha ){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		list_docs[iterator->first] = kfirst_docs( Dirichlet_embedding_model(mu , iterator->second , collection , cf , translation_matrix , collection_size , alpha ) , k );
+
+	}
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but over a document store , whose documents are read in docid order
+std::unordered_map <int,double> Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const DocumentStore &documents , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int collection_size , const double &alpha){
+
+	std::unordered_map <int,double> list_doc;
+
+	double proba;
+
+	for(unsigned int i = 0 ; i < documents.nb_docs() ; i++){
+
+		proba = Dirichlet_embedding_model(mu , query , documents.document(i) , cf , translation_matrix , collection_size , alpha );
+		if(proba!=0){list_doc[documents.id(i)]=proba;}
+
+	}
+
+	return list_doc;
+
+}
+
+
+//Same as before but only the k best documents are returned , sorted by decreasing score. The documents of the document store are split between the threads
+//(see parallel_top_k in topk.h) so that a single long query uses all the cores
+std::vector< std::pair<int,double> > Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const DocumentStore &documents , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int collection_size , const double &alpha , const int k){
+
+	return parallel_top_k(documents.doc_ids() , [&](const size_t i){return Dirichlet_embedding_model(mu , query , documents.document(i) , cf , translation_matrix , collection_size , alpha);} , k);
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score.
+//When there are fewer queries than threads the queries are scored one after the other , each one by all the threads , otherwise the queries are shared between the threads
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_embedding_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const DocumentStore &documents , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int k , const int collection_size , const double &alpha ){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	if(available_threads() > 1 && (int)query_ids.size() < available_threads()){
+
+		for(unsigned int q = 0 ; q < query_ids.size() ; q++){list_docs[query_ids[q]] = Dirichlet_embedding_model(mu , queries.at(query_ids[q]) , documents , cf , translation_matrix , collection_size , alpha , k);}
+
+		return list_docs;
+
+	}
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		list_docs[iterator->first] = kfirst_docs( Dirichlet_embedding_model(mu , iterator->second , documents , cf , translation_matrix , collection_size , alpha ) , k );
+
+	}
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but over a forward index : the distinct terms of every document are translated once instead of every term
+std::unordered_map <int,double> Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const ForwardIndex &forward_index , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int collection_size , const double &alpha){
+
+	std::unordered_map <int,double> list_doc;
+
+	double proba;
+
+	for(unsigned int i = 0 ; i < forward_index.nb_docs() ; i++){
+
+		proba = Dirichlet_embedding_model(mu , query , forward_index.document(i) , cf , translation_matrix , collection_size , alpha );
+		if(proba!=0){list_doc[forward_index.id(i)]=proba;}
+
+	}
+
+	return list_doc;
+
+}
+
+
+//Same as before but only the k best documents are returned , sorted by decreasing score. The documents of the forward index are split between the threads
+//(see parallel_top_k in topk.h) so that a single long query uses all the cores
+std::vector< std::pair<int,double> > Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const ForwardIndex &forward_index , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int collection_size , const double &alpha , const int k){
+
+	return parallel_top_k(forward_index.doc_ids() , [&](const size_t i){return Dirichlet_embedding_model(mu , query , forward_index.document(i) , cf , translation_matrix , collection_size , alpha);} , k);
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score.
+//When there are fewer queries than threads the queries are scored one after the other , each one by all the threads , otherwise the queries are shared between the threads
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_embedding_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const ForwardIndex &forward_index , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int k , const int collection_size , const double &alpha ){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	if(available_threads() > 1 && (int)query_ids.size() < available_threads()){
+
+		for(unsigned int q = 0 ; q < query_ids.size() ; q++){list_docs[query_ids[q]] = Dirichlet_embedding_model(mu , queries.at(query_ids[q]) , forward_index , cf , translation_matrix , collection_size , alpha , k);}
+
+		return list_docs;
+
+	}
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		list_docs[iterator->first] = kfirst_docs( Dirichlet_embedding_model(mu , iterator->second , forward_index , cf , translation_matrix , collection_size , alpha ) , k );
+
+	}
+
+	return list_docs;
+
+}
+
+
+//Same as before but over the entire collection using the inverted index : every term of the query is expanded into the terms it can be translated from
+//and only the postings lists of these terms are read. The translation mass p(q|d)*|d| is accumulated as the sum over the terms w of p(q|w)*tf(w,d).
+//A document that contains none of these terms gets log(cf/collection_size) for every term of the query, whatever its length , so only k of them can be in the top k.
+//The terms of the query are processed one at a time : the masses of a term are accumulated in masses , then the difference between the score of the term
+//and its background score log(cf/collection_size) is added to scores. Both accumulators are reset before use and can be reused by the next query.
+//The documents are pushed into collector , which keeps the k best of them (k being the capacity of the collector)
+void Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int collection_size , const double &alpha , ScoreAccumulator &masses , ScoreAccumulator &scores , TopkCollector &collector){
+
+	scores.reset();
+
+	int term;
+	double weight;
+	int collection_freq;
+	double collection_proba;
+	double background = 0;
+	double mass;
+	int doc;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		masses.reset();
+
+		//The term itself (translated with probability alpha + (1 - alpha)*1) then the terms it can be translated from
+		for(int j = -1 ; j < (int)translation_matrix.row_size(query[i]) ; j++){
+
+			if(j == -1){
+
+				term = query[i];
+				weight = 1;
+
+			}
+
+			else{
+
+				term = translation_matrix.row_terms(query[i])[j];
+				weight = (1 - alpha)*translation_matrix.row_probas(query[i])[j];
+
+			}
+
+			const int* docs = inverted_index.docs(term);
+			const int* tfs = inverted_index.tfs(term);
+
+			for(size_t l = 0 ; l < inverted_index.postings_size(term) ; l++){masses.add(docs[l] , weight*tfs[l]);}
+
+		}
+
+		collection_freq = coll_freq(cf , query[i]);
+		collection_proba = (double)collection_freq/collection_size;
+
+		if(collection_freq != 0){background += log(collection_proba);}
+
+		const std::vector<int> &touched = masses.touched_docs();
+
+		for(unsigned int l = 0 ; l < touched.size() ; l++){
+
+			doc = touched[l];
+			mass = masses.value(doc);
+
+			if(collection_freq != 0 && mass != 0){scores.add(doc , log( ( mass + mu*collection_proba)/(inverted_index.doc_length(doc) + mu) ) - log(collection_proba));}
+
+			else if(collection_freq == 0 && mass != 0){scores.add(doc , log( mass/inverted_index.doc_length(doc) ));}
+
+			//The document is a candidate even if the mass of the term is 0
+			else{scores.add(doc , 0);}
+
+		}
+
+	}
+
+	masses.reset();
+
+	double proba;
+
+	const std::vector<int> &candidates = scores.touched_docs();
+
+	for(unsigned int l = 0 ; l < candidates.size() ; l++){
+
+		proba = background + scores.value(candidates[l]);
+		if(proba!=0){collector.push(candidates[l] , proba);}
+
+	}
+
+	if(background == 0){return;}
+
+	const std::vector<int> &ids = inverted_index.doc_ids();
+
+	const int k = collector.capacity();
+
+	int nb_background = 0;
+
+	for(unsigned int l = 0 ; l < ids.size() && (k == -1 || nb_background < k) && background >= collector.threshold() ; l++){
+
+		if(scores.contains(ids[l])){continue;}
+
+		collector.push(ids[l] , background);
+		nb_background++;
+
+	}
+
+}
+
+
+//Same as before with accumulators allocated for this query only
+void Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int collection_size , const double &alpha , TopkCollector &collector){
+
+	ScoreAccumulator masses(inverted_index.doc_ids().size() == 0 ? 0 : inverted_index.doc_ids().back() + 1);
+	ScoreAccumulator scores(masses.size());
+
+	Dirichlet_embedding_model(mu , query , inverted_index , cf , translation_matrix , collection_size , alpha , masses , scores , collector);
+
+}
+
+
+//Same as before but the scores of the k best documents are returned in a map
+std::unordered_map <int,double> Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int collection_size , const double &alpha , const int k){
+
+	TopkCollector collector(k);
+
+	Dirichlet_embedding_model(mu , query , inverted_index , cf , translation_matrix , collection_size , alpha , collector);
+
+	return collector.scores();
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_embedding_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const TranslationMatrix &translation_matrix , const int k , const int collection_size , const double &alpha ){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel
+	{
+
+		//Every thread has its own collector and accumulators and reuses them for its queries
+		TopkCollector collector(k);
+
+		ScoreAccumulator masses(inverted_index.doc_ids().size() == 0 ? 0 : inverted_index.doc_ids().back() + 1);
+		ScoreAccumulator scores(masses.size());
+
+		#pragma omp for schedule(dynamic)
+		for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+			auto iterator = queries.find(query_ids[q]);
+
+			collector.reset();
+			Dirichlet_embedding_model(mu , iterator->second , inverted_index , cf , translation_matrix , collection_size , alpha , masses , scores , collector);
+			list_docs[iterator->first] = collector.results();
+
+		}
+
+	}
+
+	return list_docs;
+
+}
+
+
+//Same as before but from the translated postings lists materialized offline (see translated_index.h) : the lists of the terms of the query are merged
+//in docid order as for the Dirichlet language model. All the terms of the query must have been materialized.
+//The documents are pushed into collector , which keeps the k best of them (k being the capacity of the collector)
+void Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const TranslatedIndex &translated_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double &alpha , TopkCollector &collector){
+
+	std::vector<size_t> position(query.size() , 0);
+
+	std::vector<double> collection_proba(query.size() , 0);
+
+	double background = 0;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		//A term of the collection whose list was not materialized would silently get the score of an absent term in every document
+		assert(coll_freq(cf , query[i]) == 0 || translated_index.has_term(query[i]));
+
+		collection_proba[i] = (double)coll_freq(cf , query[i])/collection_size;
+		if(collection_proba[i] != 0){background += log(collection_proba[i]);}
+
+	}
+
+	std::vector<int> matched;
+
+	int doc;
+	int doc_length;
+	double mass;
+	double proba;
+
+	while(true){
+
+		doc = -1;
+
+		for(unsigned int i = 0 ; i < query.size() ; i++){
+
+			if(position[i] < translated_index.postings_size(query[i]) && (doc == -1 || translated_index.docs(query[i])[position[i]] < doc)){doc = translated_index.docs(query[i])[position[i]];}
+
+		}
+
+		if(doc == -1){break;}
+
+		matched.push_back(doc);
+		doc_length = translated_index.doc_length(doc);
+		proba = 0;
+
+		for(unsigned int i = 0 ; i < query.size() ; i++){
+
+			mass = 0;
+
+			if(position[i] < translated_index.postings_size(query[i]) && translated_index.docs(query[i])[position[i]] == doc){
+
+				mass = translated_index.tfs(query[i])[position[i]] + (1 - alpha)*translated_index.masses(query[i])[position[i]];
+				position[i]++;
+
+			}
+
+			if(collection_proba[i] != 0 && mass != 0){proba += log( ( mass + mu*collection_proba[i])/(doc_length + mu) );}
+
+			else if(collection_proba[i] != 0 && mass == 0){proba += log(collection_proba[i]);}
+
+			else if(collection_proba[i] == 0 && mass != 0){proba += log( mass/doc_length );}
+
+		}
+
+		if(proba!=0){collector.push(doc , proba);}
+
+	}
+
+	if(background == 0){return;}
+
+	//The documents that contain none of the terms get the same score whatever their length
+	const std::vector<int> &ids = translated_index.doc_ids();
+
+	const int k = collector.capacity();
+
+	int nb_background = 0;
+
+	for(unsigned int l = 0 ; l < ids.size() && (k == -1 || nb_background < k) && background >= collector.threshold() ; l++){
+
+		if(std::binary_search(matched.begin() , matched.end() , ids[l])){continue;}
+
+		collector.push(ids[l] , background);
+		nb_background++;
+
+	}
+
+}
+
+
+//Same as before but the scores of the k best documents are returned in a map
+std::unordered_map <int,double> Dirichlet_embedding_model(const double &mu , const std::vector<int> &query , const TranslatedIndex &translated_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double &alpha , const int k){
+
+	TopkCollector collector(k);
+
+	Dirichlet_embedding_model(mu , query , translated_index , cf , collection_size , alpha , collector);
+
+	return collector.scores();
+
+}
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_embedding_model(const double &mu , const std::unordered_map< int , std::vector<int> > &queries , const TranslatedIndex &translated_index , const std::unordered_map <int,int>  &cf , const int k , const int collection_size , const double &alpha ){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel
+	{
+
+		//Every thread has its own collector and reuses it for its queries
+		TopkCollector collector(k);
+
+		#pragma omp for schedule(dynamic)
+		for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+			auto iterator = queries.find(query_ids[q]);
+
+			collector.reset();
+			Dirichlet_embedding_model(mu , iterator->second , translated_index , cf , collection_size , alpha , collector);
+			list_docs[iterator->first] = collector.results();
+
+		}
+
+	}
+
+	return list_docs;
+
+}
+
+
+// Part of the translation model of a query that does not depend on mu , for one threshold and one alpha : the candidate documents,
+// their length and the translation mass p(q|d)*|d| of every term of the query , stored in one array of nb_candidates x |query| values
+class TranslationCache {
+
+public:
+
+	TranslationCache(const std::vector<int> &query , const TranslatedIndex &translated_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double &alpha , const int k);
+
+	size_t nb_candidates()const{return docs.size();}
+
+	size_t nb_terms()const{return collection_proba.size();}
+
+	int doc(const int c)const{return docs[c];}
+
+	int doc_length(const int c)const{return lengths[c];}
+
+	//Translation masses of the terms of the query in the candidate c
+	const double* masses(const int c)const{return all_masses.data() + c*nb_terms();}
+
+	double coll_proba(const int i)const{return collection_proba[i];}
+
+	//Score of the documents that contain none of the terms
+	double background()const{return background_score;}
+
+	//The documents (at most k) that contain none of the terms and complete the ranking
+	const std::vector<int>& background_docs()const{return others;}
+
+
+private:
+
+	std::vector<int> docs;
+
+	std::vector<int> lengths;
+
+	std::vector<double> all_masses;
+
+	std::vector<double> collection_proba;
+
+	double background_score;
+
+	std::vector<int> others;
+
+};
+
+
+TranslationCache::TranslationCache(const std::vector<int> &query , const TranslatedIndex &translated_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double &alpha , const int k) : collection_proba(query.size() , 0) , background_score(0) {
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		//Same check as in Dirichlet_embedding_model
+		assert(coll_freq(cf , query[i]) == 0 || translated_index.has_term(query[i]));
+
+		collection_proba[i] = (double)coll_freq(cf , query[i])/collection_size;
+		if(collection_proba[i] != 0){background_score += log(collection_proba[i]);}
+
+	}
+
+	std::vector<size_t> position(query.size() , 0);
+
+	int doc;
+
+	while(true){
+
+		doc = -1;
+
+		for(unsigned int i = 0 ; i < query.size() ; i++){
+
+			if(position[i] < translated_index.postings_size(query[i]) && (doc == -1 || translated_index.docs(query[i])[position[i]] < doc)){doc = translated_index.docs(query[i])[position[i]];}
+
+		}
+
+		if(doc == -1){break;}
+
+		docs.push_back(doc);
+		lengths.push_back(translated_index.doc_length(doc));
+
+		for(unsigned int i = 0 ; i < query.size() ; i++){
+
+			if(position[i] < translated_index.postings_size(query[i]) && translated_index.docs(query[i])[position[i]] == doc){
+
+				all_masses.push_back(translated_index.tfs(query[i])[position[i]] + (1 - alpha)*translated_index.masses(query[i])[position[i]]);
+				position[i]++;
+
+			}
+
+			else{all_masses.push_back(0);}
+
+		}
+
+	}
+
+	if(background_score == 0){return;}
+
+	const std::vector<int> &ids = translated_index.doc_ids();
+
+	for(unsigned int l = 0 ; l < ids.size() && (k == -1 || (int)others.size() < k) ; l++){
+
+		if(!std::binary_search(docs.begin() , docs.end() , ids[l])){others.push_back(ids[l]);}
+
+	}
+
+}
+
+
+
+//Same as before but for several values of mu at once from the part of the model that does not depend on mu.
+//list_docs[p] gets the k best documents for mus[p] , sorted by decreasing score
+std::vector< std::vector< std::pair<int,double> > > Dirichlet_embedding_model(const std::vector<double> &mus , const TranslationCache &cache , const int k){
+
+	std::vector<TopkCollector> collectors(mus.size() , TopkCollector(k));
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(mus.size());
+
+	double proba;
+	int doc_length;
+
+	for(unsigned int c = 0 ; c < cache.nb_candidates() ; c++){
+
+		const double* masses = cache.masses(c);
+		doc_length = cache.doc_length(c);
+
+		for(unsigned int p = 0 ; p < mus.size() ; p++){
+
+			proba = 0;
+
+			for(unsigned int i = 0 ; i < cache.nb_terms() ; i++){
+
+				if(cache.coll_proba(i) != 0 && masses[i] != 0){proba += log( ( masses[i] + mus[p]*cache.coll_proba(i))/(doc_length + mus[p]) );}
+
+				else if(cache.coll_proba(i) != 0 && masses[i] == 0){proba += log(cache.coll_proba(i));}
+
+				else if(cache.coll_proba(i) == 0 && masses[i] != 0){proba += log( masses[i]/doc_length );}
+
+			}
+
+			if(proba!=0){collectors[p].push(cache.doc(c) , proba);}
+
+		}
+
+	}
+
+	for(unsigned int p = 0 ; p < mus.size() ; p++){
+
+		for(unsigned int l = 0 ; l < cache.background_docs().size() ; l++){collectors[p].push(cache.background_docs()[l] , cache.background());}
+
+		list_docs[p] = collectors[p].results();
+
+	}
 
 	return list_docs;
 
@@ -0,0 +1,227 @@
+#ifndef document_store_h
+#define document_store_h
+
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "binary_image.h"
+
+
+// Read only view of one document of a DocumentStore , used like a std::vector<int> by the models
+class DocumentView {
+
+public:
+
+	DocumentView(const int* data , const size_t length , const bool sorted) : data(data) , length(length) , sorted(sorted) {}
+
+	size_t size()const{return length;}
+
+	const int& operator[](const size_t i)const{return data[i];}
+
+	const int* begin()const{return data;}
+
+	const int* end()const{return data + length;}
+
+	//Return true if the terms of the document are sorted
+	bool is_sorted()const{return sorted;}
+
+
+private:
+
+	const int* data;
+
+	size_t length;
+
+	bool sorted;
+
+};
+
+
+
+// Indexed collection stored contiguously : the terms of all the documents in one array, the start and the length of every document,
+// and the docids. Documents are numbered densely (0 ... nb_docs()-1) in increasing docid order
+class DocumentStore {
+
+public:
+
+	DocumentStore() : sorted(false) {}
+
+	DocumentStore(const std::unordered_map< int , std::vector<int> > &collection) : sorted(false) {build(collection);}
+
+	DocumentStore(const std::unordered_map< int , std::vector<int> > &collection , const int shard , const int nb_shards) : sorted(false) {build(collection , shard , nb_shards);}
+
+	//Build the store from an indexed collection (as produced by read_all_info_and_index)
+	void build(const std::unordered_map< int , std::vector<int> > &collection){build(collection , 0 , 1);}
+
+	//Build the store from the documents of the collection that belong to one shard : the document docid is in the shard docid % nb_shards
+	void build(const std::unordered_map< int , std::vector<int> > &collection , const int shard , const int nb_shards);
+
+	//Same as before from the documents of another store
+	void build(const DocumentStore &documents , const int shard , const int nb_shards);
+
+	//Sort the terms of every document : the models do not depend on the order of the terms and term_freq can then use a binary search
+	void sort_documents();
+
+	//Return true if the terms of every document are sorted
+	bool is_sorted()const{return sorted;}
+
+	//Number of documents (empty documents included)
+	size_t nb_docs()const{return ids.size();}
+
+	//Total number of terms of the collection
+	size_t nb_tokens()const{return tokens.size();}
+
+	//Docid of the i-th document
+	int id(const size_t i)const{return ids[i];}
+
+	//Docids of all the documents in increasing order
+	const std::vector<int>& doc_ids()const{return ids;}
+
+	//The i-th document
+	DocumentView document(const size_t i)const{return DocumentView(tokens.data() + offsets[i] , lengths[i] , sorted);}
+
+	//Length of the i-th document
+	int doc_length(const size_t i)const{return lengths[i];}
+
+	//Write the store at the end of a binary image (see binary_image.h)
+	void write(BinaryImageWriter &image)const;
+
+	//Read a store written by write , return false (with an empty store) if the image is truncated or inconsistent
+	bool read(BinaryImageReader &image);
+
+
+private:
+
+	std::vector<int> tokens;
+
+	//Start of each document in tokens
+	std::vector<size_t> offsets;
+
+	std::vector<int> lengths;
+
+	std::vector<int> ids;
+
+	bool sorted;
+
+};
+
+
+void DocumentStore::build(const std::unordered_map< int , std::vector<int> > &collection , const int shard , const int nb_shards){
+
+	ids.clear();
+	ids.reserve(nb_shards == 1 ? collection.size() : collection.size()/nb_shards + 1);
+
+	size_t nb = 0;
+
+	auto iterator = collection.begin();
+
+	while(iterator != collection.end()){
+
+		if(iterator->first % nb_shards == shard){
+
+			ids.push_back(iterator->first);
+			nb += iterator->second.size();
+
+		}
+
+		iterator++;
+
+	}
+
+	std::sort(ids.begin() , ids.end());
+
+	tokens.clear();
+	tokens.reserve(nb);
+	offsets.resize(ids.size());
+	lengths.resize(ids.size());
+
+	for(unsigned int i = 0 ; i < ids.size() ; i++){
+
+		const std::vector<int> &doc = collection.at(ids[i]);
+
+		offsets[i] = tokens.size();
+		lengths[i] = doc.size();
+		tokens.insert(tokens.end() , doc.begin() , doc.end());
+
+	}
+
+	sorted = false;
+
+}
+
+
+void DocumentStore::build(const DocumentStore &documents , const int shard , const int nb_shards){
+
+	ids.clear();
+	tokens.clear();
+	offsets.clear();
+	lengths.clear();
+
+	for(unsigned int i = 0 ; i < documents.nb_docs() ; i++){
+
+		if(documents.id(i) % nb_shards != shard){continue;}
+
+		DocumentView view = documents.document(i);
+
+		ids.push_back(documents.id(i));
+		offsets.push_back(tokens.size());
+		lengths.push_back(view.size());
+		tokens.insert(tokens.end() , view.begin() , view.end());
+
+	}
+
+	sorted = documents.is_sorted();
+
+}
+
+
+void DocumentStore::sort_documents(){
+
+	for(unsigned int i = 0 ; i < ids.size() ; i++){
+
+		std::sort(tokens.begin() + offsets[i] , tokens.begin() + offsets[i] + lengths[i]);
+
+	}
+
+	sorted = true;
+
+}
+
+
+void DocumentStore::write(BinaryImageWriter &image)const{
+
+	image.write_array(ids);
+	image.write_array(offsets);
+	image.write_array(lengths);
+	image.write_array(tokens);
+	image.write_value((uint8_t)sorted);
+
+}
+
+
+bool DocumentStore::read(BinaryImageReader &image){
+
+	uint8_t flag = 0;
+
+	if(!image.read_array(ids) || !image.read_array(offsets) || !image.read_array(lengths) || !image.read_array(tokens) || !image.read_value(flag)){return false;}
+
+	sorted = flag != 0;
+
+	//Every document must be in tokens and the docids increasing
+	bool ok = ids.size() == offsets.size() && ids.size() == lengths.size();
+
+	for(size_t i = 0 ; ok && i < ids.size() ; i++){
+
+		ok = lengths[i] >= 0 && offsets[i] <= tokens.size() && (size_t)lengths[i] <= tokens.size() - offsets[i] && (i == 0 || ids[i-1] < ids[i]);
+
+	}
+
+	if(!ok){*this = DocumentStore();}
+
+	return ok;
+
+}
+
+
+#endif
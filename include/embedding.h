@@ -4,6 +4,8 @@
 #include "character.h"
 #include "word.h"
 #include "sentence.h"
+#include "binary_image.h"
+#include "vector_kernels.h"
 #include <cstring>
 #include <cstdio>
 #include <iostream>
@@ -12,11 +14,49 @@
 #include <sstream>
 #include <unordered_map>
 #include <cmath>
+#include <chrono>
+#include <cctype>
+#include <algorithm>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <memory>
+#include <random>
 
 
 const long long N = 1;                   // number of closest words that will be shown
 
 #define err1 0x0000 // la fonction lecture_fichier_bin n a pas trouve le repertoire en entree
+#define err2 0x0001 // the binary file of the embeddings is truncated
+#define err3 0x0002 // a file of the embeddings could not be opened or written (err1 being 0 , it can not be told apart from a success)
+
+
+//Magic number ("CEMB") and version of the cache of the normalized embeddings
+static const uint32_t embedding_cache_magic = 0x43454d42;
+static const uint32_t embedding_cache_version = 2;
+
+
+//FNV-1a hash of a word , used by the hash table of the cache
+inline uint64_t embedding_hash(const char* word , const size_t length){
+
+	uint64_t hash = 14695981039346656037ULL;
+
+	for(size_t i = 0 ; i < length ; i++){
+
+		hash ^= (unsigned char)word[i];
+		hash *= 1099511628211ULL;
+
+	}
+
+	return hash;
+
+}
+
+
+//Storage of the embedded std::vectors read by the similarities (see Embedding::quantize)
+enum EmbeddingStorage { FLOAT_STORAGE , HALF_STORAGE , INT8_STORAGE };
 
 
 // To store a vocabulary and the embedded std::vectors
@@ -24,7 +64,7 @@ class Embedding {
 
 public:
 
-	Embedding(){}
+	Embedding() : size(0) , matrix(nullptr) , nb_words(0) , words(nullptr) , word_offsets(nullptr) , table(nullptr) , table_size(0) , storage(FLOAT_STORAGE) , rescoring_margin(0) {}
 
 	// Load all data from binary word2vect format
 	// Return 0 if OK
@@ -33,10 +73,27 @@ public:
     int load_Word2VecBinFormat(const std::string& filename ///< the name of the binary file
 	) {return load_Word2VecBinFormat(filename.c_str());}
 
+	// Write the normalized vectors , the vocabulary and its hash table in a binary image , with the word2vec file they were read from ,
+	// return false if the file could not be written or if the float vectors were freed. Only the vocabulary of the word2vec file is saved
+	// (not the one read by set_hmap)
+	bool save_cache(const std::string &file_name)const;
+
+	// Map a cache written by save_cache : the vectors , the words and the hash table are used in place , without any parsing , and the
+	// pages of the file are shared read-only by all the processes that map it. Return false if the file is not a valid cache or if its
+	// word2vec file has been modified since it was written (see BinaryImageReader::read_source)
+	bool load_cache(const std::string &file_name);
+
+	// Load the cache if cache_file is a valid cache of word2vec_file , otherwise load the word2vec file and write the cache. Return 0 if OK
+	int load(const std::string &word2vec_file , const std::string &cache_file);
+
+	// Return a pointer to the embedded std::vector of the term whose id is term , nullptr if it has none. For a subset written by
+	// extract_embeddings the ids are the ones of the index of the collection , otherwise they are the positions in the word2vec file
+	float* get_term(const int term);
+
 	//Save the vocabulary in a file
 	void save_voc(const std::string &file_name);
 
-	//Read the vocabulary from a file
+	//Read the vocabulary from a file , its words are found before the ones of a cache
 	void set_hmap(const std::unordered_map<std::string,int> &stemmed , const std::string &file_name);
 
     // Return a ponter to the embedded std::vector of the word word
@@ -61,10 +118,41 @@ public:
 	void display_attributes();
 
 	//Get size of vocabulary
-	size_t size_voc()const{return vocab.size();}
+	size_t size_voc()const{return nb_words;}
+
+	//Size of the embedded std::vectors
+	size_t dimension()const{return size;}
+
+	// Also store the normalized vectors in half precision (HALF_STORAGE) or in bytes with one scale per vector (INT8_STORAGE) : the
+	// similarities of closest.h and expand_queries then read 2 or 4 times less memory. Unless keep_floats is true , the float vectors read
+	// from a word2vec file are freed , which disables get , cosine and the rescoring (those of a cache are kept since only the pages that
+	// are read are loaded). FLOAT_STORAGE frees the quantized vectors , it needs the float vectors
+	void quantize(const EmbeddingStorage storage , const bool keep_floats);
+
+	EmbeddingStorage get_storage()const{return storage;}
+
+	//False if the float vectors were freed by quantize
+	bool has_floats()const{return matrix != nullptr || nb_words == 0;}
+
+	// A quantized similarity closer than margin to the value it is compared to (a threshold or the last of the best similarities) is
+	// recomputed with the float vectors. 0 (the default) for no rescoring. Return false (and keep no rescoring) if the float vectors were freed
+	bool set_rescoring_margin(const float margin);
+
+	// Similarity of the words whose ids are id1 and id2 with the storage of the vectors , rescored if it is closer than the margin to threshold
+	float similarity(const int id1 , const int id2 , const double threshold)const;
+
+	// Largest difference between the similarity of the storage (without rescoring) and the cosine of the float vectors over nb_pairs random pairs of words ,
+	// -1 if the float vectors were freed
+	float max_cosine_error(const size_t nb_pairs)const;
+
+	// Bytes of the vectors read by the similarities
+	size_t storage_bytes()const;
+
+	//Id of the word , -1 if it is not in the vocabulary
+	int find(const char* word)const;
 
 	//Return the list of all the words (to use for debug only)
-	const char* operator[](const unsigned int id ) const{return vocab[id].c_str();}
+	const char* operator[](const unsigned int id ) const{return cache ? words + word_offsets[id] : vocab[id].c_str();}
 
 
 private:
@@ -81,6 +169,43 @@ private:
 	//Size of each embedded std::vectors
 	uint64_t size;
 
+	//The word2vec file the vectors were read from
+	std::string source_file;
+
+	//The embedded std::vectors : M or the vectors of the cache , which must not be modified
+	const float* matrix;
+
+	//Number of words
+	uint64_t nb_words;
+
+	//Mapped cache , its words (each one followed by a 0) and its hash table : the id of the word or -1 , with linear probing
+	std::shared_ptr<BinaryImageReader> cache;
+
+	const char* words;
+
+	const uint64_t* word_offsets;
+
+	const int* table;
+
+	uint64_t table_size;
+
+	//Storage of the similarities , the vectors in half precision , the vectors in bytes and their scales (a value is its byte times the scale)
+	EmbeddingStorage storage;
+
+	std::vector<uint16_t> half_matrix;
+
+	std::vector<int8_t> byte_matrix;
+
+	std::vector<float> byte_scales;
+
+	float rescoring_margin;
+
+	// Dot product of a vector quantized like the stored ones (half , or bytes and scale) and of the stored vector of id
+	float stored_dot(const uint16_t* half , const int8_t* bytes , const float scale , const size_t id)const;
+
+	// Add the stored vector of id to sum (the float one if it was kept)
+	void add_stored(float* sum , const size_t id)const;
+
 	// Return a ponter to the embedded std::vector that starts at indice i
 	float* get(size_t i);
 
@@ -103,6 +228,9 @@ void Embedding::save_voc(const std::string &file_name){
 
 	}
 
+	//The vocabulary of a cache is not in hmap
+	for(uint64_t b = 0 ; cache && b < nb_words ; b++){myfile << std::string((*this)[b]) + " " + std::to_string(b) + "\n";}
+
   	myfile.close();
 
 }
@@ -159,57 +287,113 @@ void Embedding::set_hmap(const std::unordered_map<std::string,int> &stemmed , co
 
 
 // Read in memory a binary file of vod2vec output
+//The file is mapped in memory : the records (a word , a space , then size floats) start after variable length words so their offsets are found
+//by one pass that only reads the words and jumps over the vectors. The vectors are then copied into M and normalized in parallel
 int Embedding::load_Word2VecBinFormat (
 const char* file_name ///< the name of the binary file
 	)
 {
-	std::cout<<"Before opening binary file"<<std::endl;
-	// Open the binary file
-	FILE *f = fopen(file_name, "rb");
-	if(f == NULL) return int(err1);
+	int descriptor = open(file_name , O_RDONLY);
+	if(descriptor == -1) return int(err1);
+
+	struct stat status;
+
+	if(fstat(descriptor , &status) != 0 || status.st_size == 0){close(descriptor); return int(err1);}
+
+	size_t length = status.st_size;
+	void* mapping = mmap(nullptr , length , PROT_READ , MAP_PRIVATE , descriptor , 0);
+
+	close(descriptor);
 
-	std::cout<<"After opening binary file"<<std::endl;
+	if(mapping == MAP_FAILED) return int(err1);
 
-	uint64_t words;
+	madvise(mapping , length , MADV_WILLNEED);
 
-	//Reading the header of the file
-	//Warning(1) : the integers must have a lower value than 2^64
-	//Warning(2) : the scanf must get than l means 64 bits
-	fscanf(f, "%lu", &words);
-	fscanf(f, "%lu", &size);
+	const char* data = (const char*)mapping;
+	const char* end = data + length;
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+	//Reading the header of the file : the number of words and the size of the vectors
+	uint64_t words = 0;
+	size = 0;
+
+	const char* position = data;
+
+	while(position < end && isspace((unsigned char)*position)) position++;
+	while(position < end && isdigit((unsigned char)*position)) words = 10*words + (*position++ - '0');
+	while(position < end && isspace((unsigned char)*position) && *position != '\n') position++;
+	while(position < end && isdigit((unsigned char)*position)) size = 10*size + (*position++ - '0');
+	while(position < end && *position != '\n') position++;
 
 	std::cout<< "Size of the vocab : " <<words<<std::endl;
 	std::cout<< "Size of the std::vectors : " <<size<<std::endl;
-	// Reserve memory for the vocabulary
+
+	//Offsets of the words and of the vectors
+	std::vector<const char*> word_starts(words);
+	std::vector<size_t> word_lengths(words);
+
+	for (size_t b = 0; b < words; b++)
+	{
+
+		while(position < end && isspace((unsigned char)*position)) position++;
+
+		word_starts[b] = position;
+		while(position < end && *position != ' ') position++;
+		word_lengths[b] = position - word_starts[b];
+
+		//The space between the word and the vector
+		position++;
+
+		if(position + size*sizeof(float) > end){
+
+			std::cout<<"The file "<<file_name<<" is truncated after "<<b<<" words"<<std::endl;
+			munmap(mapping , length);
+			return int(err2);
+
+		}
+
+		position += size*sizeof(float);
+
+	}
+
 	vocab.resize(words);
-	std::cout<<"After allocation of the vocab"<<std::endl;
-	// Reserve memory for the matrix of embedded std::vectors
 	M.resize(words*size);
-	std::cout<<"After allocation of the vectors"<<std::endl;
-	//separator char between the word and the embedded std::vector
-	char ch;
-	std::cout<<"Starting reading binary file : "<<std::endl;
-	for (size_t b = 0; b < words; b++)
+
+	#pragma omp parallel for schedule(static)
+	for (long long b = 0; b < (long long)words; b++)
 	{
 
-		std::cout<<"\rProcessing ...................."<< 100*(b+1)/words <<"%"<<std::flush;
+		size_t word_length = std::min(word_lengths[b] , (size_t)max_w - 1);
+		memcpy(&vocab[b][0] , word_starts[b] , word_length);
+		vocab[b][word_length] = 0;
+
+		//The vectors are not aligned in the file
+		float* vector = &M[b * size];
+		memcpy(vector , word_starts[b] + word_lengths[b] + 1 , size*sizeof(float));
 
-		//Reads the bth word
-		fscanf(f, "%s%c", &vocab[b][0], &ch);
-		hmap[vocab[b].to_string()] = b;
-		//Read the bth std::vector
-		fread(&M[b * size], sizeof(float), size , f);
 		//Normalization of the std::vectors
-		float len = 0;
-		for (size_t a = 0; a < size; a++) len += M[a + b * size] * M[a + b * size];
-		len = sqrt(len);
-		for (size_t a = 0; a < size; a++) M[a + b * size] /= len;
+		normalize_vector(vector , size);
 
-  	}
-	std::cout<<std::endl;
-	fclose(f);
+	}
+
+	hmap.clear();
+	hmap.reserve(words);
+
+	//Keyed by the words of vocab , truncated to max_w - 1 characters
+	for (size_t b = 0; b < words; b++) hmap[std::string(word_starts[b] , std::min(word_lengths[b] , (size_t)max_w - 1))] = b;
+
+	munmap(mapping , length);
 
-	//save_voc("non_stemmed_voc");
+	cache.reset();
+	matrix = M.data();
+	nb_words = words;
+	source_file = file_name;
+
+	//The quantized vectors of the previous embeddings are freed
+	quantize(FLOAT_STORAGE , true);
+
+	std::cout<<"Embeddings loaded in "<<std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count()<<" s"<<std::endl;
 
 	return 0;
 }
@@ -222,16 +406,18 @@ const char* file_name ///< the name of the binary file
 
 float* Embedding::get(const char* word){
 
-	std::string term = std::string(word);
+	int id = find(word);
 
-	auto it = hmap.find( term );
+	if(id != -1){
 
-	if(it != hmap.end()){
-
-		return get(it->second);
+		return get(id);
 
 	}
+
 	/*
+	std::string term = std::string(word);
+	auto it = hmap.find( term );
+
 	for( unsigned int i = 0 ; i < term.size() ; i++){
 
 		if( term[i] > 47 && term[i] < 58 ){
@@ -273,8 +459,338 @@ float* Embedding::get(const char* word){
 
 inline
 float* Embedding::get(size_t i){
-	assert( i < vocab.size() );
-	return &M[i*size];
+	assert( i < nb_words );
+
+	if(matrix == nullptr){
+
+		std::cout<<"The float vectors of the embeddings were freed by quantize , load them again or quantize with keep_floats"<<std::endl;
+		exit(-1);
+
+	}
+
+	return const_cast<float*>(matrix + i*size);
+
+}
+
+
+int Embedding::find(const char* word)const{
+
+	//The words read by set_hmap are also found with a cache , before the ones of its table
+	if(!cache || !hmap.empty()){
+
+		auto it = hmap.find( std::string(word) );
+
+		if(it != hmap.end()){return it->second;}
+
+		if(!cache){return -1;}
+
+	}
+
+	if(table_size == 0){return -1;}
+
+	size_t length = strlen(word);
+
+	for(uint64_t slot = embedding_hash(word , length) & (table_size - 1) ; table[slot] != -1 ; slot = (slot + 1) & (table_size - 1)){
+
+		int id = table[slot];
+
+		if(word_offsets[id + 1] - word_offsets[id] == length + 1 && memcmp(words + word_offsets[id] , word , length) == 0){return id;}
+
+	}
+
+	return -1;
+
+}
+
+
+//Write a cache of nb_words vectors of size floats : the word of the vector b is words[b] , and only the words such that hashed[b] is true
+//can be found by their string (see Embedding::load_cache). Return false if the file could not be written
+bool write_embedding_cache(const std::string &file_name , const std::string &source_file , const uint64_t size , const float* matrix , const std::vector<std::string> &words , const std::vector<bool> &hashed){
+
+	BinaryImageWriter image(file_name , embedding_cache_magic , embedding_cache_version);
+
+	uint64_t nb_words = words.size();
+
+	image.write_source(source_file);
+
+	image.write_value(size);
+	image.write_array(matrix , nb_words*size);
+
+	std::vector<uint64_t> offsets(1 , 0);
+	std::vector<char> characters;
+
+	for(uint64_t b = 0 ; b < nb_words ; b++){
+
+		characters.insert(characters.end() , words[b].c_str() , words[b].c_str() + words[b].size() + 1);
+		offsets.push_back(characters.size());
+
+	}
+
+	//At most half full , a later word replaces an earlier identical one as in hmap
+	uint64_t capacity = 1;
+	while(capacity < 2*nb_words) capacity *= 2;
+
+	std::vector<int> slots(capacity , -1);
+
+	for(uint64_t b = 0 ; b < nb_words ; b++){
+
+		if(!hashed[b]) continue;
+
+		uint64_t slot = embedding_hash(words[b].c_str() , words[b].size()) & (capacity - 1);
+
+		while(slots[slot] != -1 && words[slots[slot]] != words[b]) slot = (slot + 1) & (capacity - 1);
+
+		slots[slot] = b;
+
+	}
+
+	image.write_array(offsets);
+	image.write_array(characters);
+	image.write_array(slots);
+
+	return image.close();
+
+}
+
+
+bool Embedding::save_cache(const std::string &file_name)const{
+
+	if(!has_floats()){return false;}
+
+	std::vector<std::string> vocabulary(nb_words);
+
+	for(uint64_t b = 0 ; b < nb_words ; b++) vocabulary[b] = (*this)[b];
+
+	return write_embedding_cache(file_name , source_file , size , matrix , vocabulary , std::vector<bool>(nb_words , true));
+
+}
+
+
+float* Embedding::get_term(const int term){
+
+	if(term < 0 || (uint64_t)term >= nb_words){return nullptr;}
+
+	return find((*this)[term]) == term ? get(term) : nullptr;
+
+}
+
+
+bool Embedding::load_cache(const std::string &file_name){
+
+	std::shared_ptr<BinaryImageReader> image(new BinaryImageReader(file_name , embedding_cache_magic , embedding_cache_version));
+
+	uint64_t dimension , nb_values , nb_offsets , nb_characters , nb_slots;
+
+	std::string source;
+
+	if(!image->good()){return false;}
+
+	if(!image->read_source(source)){
+
+		if(image->good()){std::cout<<"The cache of the embeddings "<<file_name<<" is out of date , "<<source<<" has been modified"<<std::endl;}
+		return false;
+
+	}
+
+	if(!image->read_value(dimension)){return false;}
+
+	const float* vectors = image->read_array<float>(nb_values);
+	const uint64_t* offsets = image->read_array<uint64_t>(nb_offsets);
+	const char* characters = image->read_array<char>(nb_characters);
+	const int* slots = image->read_array<int>(nb_slots);
+
+	if(!image->good() || nb_offsets == 0 || (dimension == 0 ? nb_values != 0 : nb_values % dimension != 0 || nb_values/dimension != nb_offsets - 1) || offsets[0] != 0 || offsets[nb_offsets - 1] != nb_characters || (nb_slots & (nb_slots - 1)) != 0){return false;}
+
+	//Every word ends with a 0 inside characters , and the table only holds ids of words and has an empty slot , which ends every probe of find
+	for(uint64_t b = 0 ; b + 1 < nb_offsets ; b++){
+
+		if(offsets[b] >= offsets[b+1] || offsets[b+1] > nb_characters || characters[offsets[b+1] - 1] != 0){return false;}
+
+	}
+
+	bool empty_slot = false;
+
+	for(uint64_t slot = 0 ; slot < nb_slots ; slot++){
+
+		if(slots[slot] < -1 || (slots[slot] != -1 && (uint64_t)slots[slot] >= nb_offsets - 1)){return false;}
+
+		empty_slot = empty_slot || slots[slot] == -1;
+
+	}
+
+	if(nb_slots != 0 && !empty_slot){return false;}
+
+	cache = image;
+	source_file = source;
+	size = dimension;
+	matrix = vectors;
+	nb_words = nb_offsets - 1;
+	word_offsets = offsets;
+	words = characters;
+	table = slots;
+	table_size = nb_slots;
+
+	hmap.clear();
+	std::vector<Word>().swap(vocab);
+	std::vector<float>().swap(M);
+
+	quantize(FLOAT_STORAGE , true);
+
+	std::cout<< "Size of the vocab : " <<nb_words<<std::endl;
+	std::cout<< "Size of the std::vectors : " <<size<<std::endl;
+
+	return true;
+
+}
+
+
+int Embedding::load(const std::string &word2vec_file , const std::string &cache_file){
+
+	if(load_cache(cache_file)){
+
+		if(source_file == word2vec_file){return 0;}
+
+		std::cout<<"The cache of the embeddings "<<cache_file<<" was built from "<<source_file<<" , not from "<<word2vec_file<<std::endl;
+
+		*this = Embedding();
+
+	}
+
+	int res = load_Word2VecBinFormat(word2vec_file);
+
+	if(nb_words != 0 && !save_cache(cache_file)){std::cout<<"Could not write the cache of the embeddings "<<cache_file<<std::endl;}
+
+	return res;
+
+}
+
+
+// Read the word2vec file once , as a stream , and keep only the vectors of the words of index : the normalized vector of the word whose id is t
+// is the row t of a cache written in subset_file (see Embedding::load_cache and Embedding::get_term) , which only holds the vocabulary of the
+// collection. embedded[t] is set to true if the term t has an embedding. Return 0 if OK
+int extract_embeddings(const std::string &word2vec_file , const std::unordered_map<std::string,int> &index , const std::string &subset_file , std::vector<bool> &embedded){
+
+	FILE *f = fopen(word2vec_file.c_str(), "rb");
+	if(f == NULL){std::cout<<"Could not open "<<word2vec_file<<std::endl; return int(err3);}
+
+	std::vector<char> buffer(1 << 24);
+	setvbuf(f , buffer.data() , _IOFBF , buffer.size());
+
+	uint64_t words , size;
+
+	if(fscanf(f, "%lu", &words) != 1 || fscanf(f, "%lu", &size) != 1){fclose(f); return int(err2);}
+
+	int max_id = -1;
+	for(auto iterator = index.begin() ; iterator != index.end() ; iterator++) max_id = std::max(max_id , iterator->second);
+
+	std::vector<std::string> vocabulary(max_id + 1);
+	for(auto iterator = index.begin() ; iterator != index.end() ; iterator++) vocabulary[iterator->second] = iterator->first;
+
+	embedded.assign(max_id + 1 , false);
+
+	std::vector<float> subset((max_id + 1)*size , 0);
+	std::vector<float> vector(size);
+	std::string word;
+
+	for (uint64_t b = 0; b < words; b++)
+	{
+
+		int ch = getc_unlocked(f);
+		while(ch != EOF && isspace(ch)) ch = getc_unlocked(f);
+
+		word.clear();
+		while(ch != EOF && ch != ' '){word.push_back(ch); ch = getc_unlocked(f);}
+
+		if(ch == EOF || fread(vector.data() , sizeof(float) , size , f) != size){
+
+			std::cout<<"The file "<<word2vec_file<<" is truncated after "<<b<<" words"<<std::endl;
+			fclose(f);
+			return int(err2);
+
+		}
+
+		auto it = index.find(word);
+
+		if(it == index.end()) continue;
+
+		float* row = &subset[it->second * size];
+		memcpy(row , vector.data() , size*sizeof(float));
+		normalize_vector(row , size);
+
+		embedded[it->second] = true;
+
+	}
+
+	fclose(f);
+
+	if(!write_embedding_cache(subset_file , word2vec_file , size , subset.data() , vocabulary , embedded)){
+
+		std::cout<<"Could not write the embeddings "<<subset_file<<std::endl;
+		return int(err3);
+
+	}
+
+	return 0;
+
+}
+
+
+//Same as before but the percentages of the terms of the vocabulary and of the words of the collection that have an embedding are displayed
+//(as nb_embedded_words_in_voc does)
+int extract_embeddings(const std::string &word2vec_file , const std::unordered_map<std::string,int> &index , const std::unordered_map <int,int> &cf , const std::string &subset_file){
+
+	std::vector<bool> embedded;
+
+	int res = extract_embeddings(word2vec_file , index , subset_file , embedded);
+
+	if(res != 0){return res;}
+
+	size_t count = 0;
+	size_t nb_words_tot = 0;
+	size_t nb_words_emb = 0;
+
+	for(auto iterator = index.begin() ; iterator != index.end() ; iterator++){
+
+		auto it = cf.find(iterator->second);
+		size_t frequency = it == cf.end() ? 0 : it->second;
+
+		if(iterator->second < (int)embedded.size() && embedded[iterator->second]){
+
+			count++;
+			nb_words_emb += frequency;
+
+		}
+
+		nb_words_tot += frequency;
+
+	}
+
+	std::cout<<"Percentage of words of the vocabulary that have an embedding : "<< double(count)*100/std::max(index.size() , (size_t)1)<<"%"<<std::endl;
+	std::cout<<"Percentage of words of the collection that have an embedding : "<< double(nb_words_emb)*100/std::max(nb_words_tot , (size_t)1)<<"%"<<std::endl;
+
+	return res;
+
+}
+
+
+//Same as before for a list of terms , the id of a term being its position in the list
+int extract_embeddings(const std::string &word2vec_file , const std::vector<std::string> &terms , const std::string &subset_file){
+
+	std::unordered_map<std::string,int> index;
+
+	for(unsigned int i = 0 ; i < terms.size() ; i++) index[terms[i]] = i;
+
+	std::vector<bool> embedded;
+
+	int res = extract_embeddings(word2vec_file , index , subset_file , embedded);
+
+	if(res != 0){return res;}
+
+	size_t count = std::count(embedded.begin() , embedded.end() , true);
+
+	std::cout<<"Percentage of the terms that have an embedding : "<< double(count)*100/std::max(terms.size() , (size_t)1)<<"%"<<std::endl;
+
+	return res;
 
 }
 
@@ -285,7 +801,7 @@ int Embedding::check_embedding(const std::vector<std::string> &query){
 
 	for(unsigned int i = 0 ; i < query.size() ; i++){
 
-		if(get(query[i].c_str()) != nullptr){res++;}
+		if(find(query[i].c_str()) != -1){res++;}
 
 	}
 
@@ -295,185 +811,255 @@ int Embedding::check_embedding(const std::vector<std::string> &query){
 
 
 
-float Embedding::cosine(const char* word1, const char* word2){
+void Embedding::quantize(const EmbeddingStorage storage , const bool keep_floats){
 
-	float *vect1 = get(word1);
-	float *vect2 = get(word2);
-	if(vect1 == nullptr || vect2 == nullptr){return 0;}
-	float dist = 0;
-	for(unsigned int i = 0; i < size ; i++){
+	if(!has_floats()){
 
-		dist += (*vect1)*(*vect2);
-		vect1++;
-		vect2++;
+		std::cout<<"The float vectors of the embeddings were freed , they can not be quantized again"<<std::endl;
+		return;
 
 	}
 
-	return dist;
-}
+	this->storage = storage;
 
+	std::vector<uint16_t>().swap(half_matrix);
+	std::vector<int8_t>().swap(byte_matrix);
+	std::vector<float>().swap(byte_scales);
 
-float Embedding::cosine(const std::vector<std::string> &set1 , const std::string &set2 ){
+	if(storage == HALF_STORAGE){half_matrix.resize(nb_words*size);}
 
-	if(set1.size() == 0){return 0;}
+	if(storage == INT8_STORAGE){
 
-	float *term2 = get(set2.c_str());
+		byte_matrix.resize(nb_words*size);
+		byte_scales.resize(nb_words);
 
-	if(term2==nullptr){return 0;}
+	}
 
-	float *sumvect1 = nullptr;
+	if(storage == FLOAT_STORAGE){return;}
 
-	unsigned int iterator1 = 0;
+	#pragma omp parallel for schedule(static)
+	for (long long b = 0; b < (long long)nb_words; b++){
 
-	while(sumvect1 == nullptr && iterator1 < set1.size()){
+		if(storage == HALF_STORAGE){to_half(matrix + b*size , &half_matrix[b*size] , size);}
 
+		else{byte_scales[b] = to_bytes(matrix + b*size , &byte_matrix[b*size] , size);}
 
-		sumvect1 = get(set1[iterator1].c_str());
-		iterator1++;
+	}
+
+	if(keep_floats || cache){return;}
+
+	std::vector<float>().swap(M);
+	matrix = nullptr;
+	rescoring_margin = 0;
+
+}
+
+
+bool Embedding::set_rescoring_margin(const float margin){
+
+	if(margin > 0 && !has_floats()){
+
+		std::cout<<"The float vectors of the embeddings were freed by quantize , no rescoring"<<std::endl;
+		return false;
 
 	}
 
-	if(sumvect1 == nullptr){return 0;}
+	rescoring_margin = margin;
 
-	float *vect;
+	return true;
 
-	float len = 0;
+}
 
-	for(unsigned int i = iterator1+1 ; i < set1.size() ; i++){
 
-		vect = get(set1[i].c_str());
+void Embedding::add_stored(float* sum , const size_t id)const{
 
-		if(vect != nullptr){
+	if(matrix != nullptr){add_vector(sum , matrix + id*size , size); return;}
 
+	for(uint64_t i = 0 ; i < size ; i++){sum[i] += storage == HALF_STORAGE ? half_to_float(half_matrix[id*size + i]) : byte_matrix[id*size + i]*byte_scales[id];}
 
-				for(unsigned int j = 0; j < size ; j++){
+}
 
-					sumvect1[j] += (*vect);
-					vect++;
 
-				}
+float Embedding::stored_dot(const uint16_t* half , const int8_t* bytes , const float scale , const size_t id)const{
 
-		}
+	if(storage == HALF_STORAGE){return dot_product(half , &half_matrix[id*size] , size);}
+
+	return dot_product(bytes , &byte_matrix[id*size] , size)*scale*byte_scales[id];
+
+}
+
+
+float Embedding::similarity(const int id1 , const int id2 , const double threshold)const{
+
+	if(storage == FLOAT_STORAGE){return dot_product(matrix + id1*size , matrix + id2*size , size);}
+
+	float cos = storage == HALF_STORAGE ? stored_dot(&half_matrix[id1*size] , nullptr , 0 , id2) : stored_dot(nullptr , &byte_matrix[id1*size] , byte_scales[id1] , id2);
+
+	if(std::abs(cos - threshold) < rescoring_margin){cos = dot_product(matrix + id1*size , matrix + id2*size , size);}
+
+	return cos;
+
+}
 
-	}
-	len = 0;
-	for (unsigned int i = 0; i < size ; i++) len += sumvect1[i]*sumvect1[i];
-	len = sqrt(len);
-	for (unsigned int i = 0; i < size ; i++) sumvect1[i]/= len;
 
+float Embedding::max_cosine_error(const size_t nb_pairs)const{
 
-	float dist = 0;
+	if(storage == FLOAT_STORAGE || nb_words == 0){return 0;}
 
-	for(unsigned int i = 0; i < size ; i++){
+	if(matrix == nullptr){return -1;}
 
-		dist += (*sumvect1)*(*term2);
-		sumvect1++;
-		term2++;
+	std::mt19937 generator(0);
+	std::uniform_int_distribution<size_t> random_id(0 , nb_words - 1);
+
+	float error = 0;
+
+	for(size_t p = 0 ; p < nb_pairs ; p++){
+
+		size_t id1 = random_id(generator);
+		size_t id2 = random_id(generator);
+
+		float cos = storage == HALF_STORAGE ? stored_dot(&half_matrix[id1*size] , nullptr , 0 , id2) : stored_dot(nullptr , &byte_matrix[id1*size] , byte_scales[id1] , id2);
+
+		error = std::max(error , std::abs(cos - dot_product(matrix + id1*size , matrix + id2*size , size)));
 
 	}
 
-	return dist;
+	return error;
 
 }
 
 
+size_t Embedding::storage_bytes()const{
 
+	if(storage == HALF_STORAGE){return half_matrix.size()*sizeof(uint16_t);}
 
+	if(storage == INT8_STORAGE){return byte_matrix.size()*sizeof(int8_t) + byte_scales.size()*sizeof(float);}
 
+	return nb_words*size*sizeof(float);
 
-float Embedding::cosine(const std::vector<std::string> &set1 , const std::vector<std::string> &set2 ){
+}
 
-	if(set1.size() == 0 || set2.size() == 0 ){return 0;}
 
-	float *sumvect1 = nullptr;
-	float *sumvect2 = nullptr;
+
+float Embedding::cosine(const char* word1, const char* word2){
+
+	float *vect1 = get(word1);
+	float *vect2 = get(word2);
+	if(vect1 == nullptr || vect2 == nullptr){return 0;}
+
+	return dot_product(vect1 , vect2 , size);
+}
+
+
+float Embedding::cosine(const std::vector<std::string> &set1 , const std::string &set2 ){
+
+	if(set1.size() == 0){return 0;}
+
+	float *term2 = get(set2.c_str());
+
+	if(term2==nullptr){return 0;}
+
+	float *first1 = nullptr;
 
 	unsigned int iterator1 = 0;
 
-	while(sumvect1 == nullptr && iterator1 < set1.size()){
+	while(first1 == nullptr && iterator1 < set1.size()){
 
 
-		sumvect1 = get(set1[iterator1].c_str());
+		first1 = get(set1[iterator1].c_str());
 		iterator1++;
 
 	}
 
-	if(sumvect1 == nullptr){return 0;}
+	if(first1 == nullptr){return 0;}
 
-	unsigned int iterator2 = 0;
+	//The sum is computed in a copy since the vectors can be in a read-only cache
+	std::vector<float> sum1(first1 , first1 + size);
+	float *sumvect1 = sum1.data();
+
+	float *vect;
 
-	while(sumvect2 == nullptr && iterator2 < set2.size()){
+	for(unsigned int i = iterator1+1 ; i < set1.size() ; i++){
 
+		vect = get(set1[i].c_str());
 
-		sumvect2 = get(set2[iterator2].c_str());
-		iterator2++;
+		if(vect != nullptr){add_vector(sumvect1 , vect , size);}
 
 	}
 
-	if(sumvect2 == nullptr){return 0;}
+	normalize_vector(sumvect1 , size);
 
 
-	float *vect;
+	return dot_product(sumvect1 , term2 , size);
 
-	float len = 0;
+}
 
-	for(unsigned int i = iterator1+1 ; i < set1.size() ; i++){
 
-		vect = get(set1[i].c_str());
 
-		if(vect != nullptr){
 
 
-				for(unsigned int j = 0; j < size ; j++){
 
-					sumvect1[j] += (*vect);
-					vect++;
+float Embedding::cosine(const std::vector<std::string> &set1 , const std::vector<std::string> &set2 ){
 
-				}
+	if(set1.size() == 0 || set2.size() == 0 ){return 0;}
 
-		}
+	float *first1 = nullptr;
+	float *first2 = nullptr;
 
-	}
-	len = 0;
-	for (unsigned int i = 0; i < size ; i++) len += sumvect1[i]*sumvect1[i];
-	len = sqrt(len);
-	for (unsigned int i = 0; i < size ; i++) sumvect1[i]/= len;
+	unsigned int iterator1 = 0;
 
-	for(unsigned int i = 1 ; i < set2.size() ; i++){
+	while(first1 == nullptr && iterator1 < set1.size()){
 
-		vect = get(set2[i].c_str());
 
-		if(vect != nullptr){
+		first1 = get(set1[iterator1].c_str());
+		iterator1++;
+
+	}
 
-			for(unsigned int j = 0; j < size ; j++){
+	if(first1 == nullptr){return 0;}
 
-				sumvect2[j] += (*vect);
-				vect++;
+	unsigned int iterator2 = 0;
 
-			}
+	while(first2 == nullptr && iterator2 < set2.size()){
 
-		}
+
+		first2 = get(set2[iterator2].c_str());
+		iterator2++;
 
 	}
 
+	if(first2 == nullptr){return 0;}
+
+	//The sums are computed in copies since the vectors can be in a read-only cache
+	std::vector<float> sum1(first1 , first1 + size);
+	std::vector<float> sum2(first2 , first2 + size);
+	float *sumvect1 = sum1.data();
+	float *sumvect2 = sum2.data();
 
-	len = 0;
-	for (unsigned int i = 0; i < size ; i++) len += sumvect2[i]*sumvect2[i];
-	len = sqrt(len);
-	for (unsigned int i = 0; i < size ; i++) sumvect2[i]/= len;
 
+	float *vect;
 
-	float dist = 0;
+	for(unsigned int i = iterator1+1 ; i < set1.size() ; i++){
 
-	for(unsigned int i = 0; i < size ; i++){
+		vect = get(set1[i].c_str());
 
-		dist += (*sumvect1)*(*sumvect2);
-		sumvect1++;
-		sumvect2++;
+		if(vect != nullptr){add_vector(sumvect1 , vect , size);}
 
 	}
 
-	return dist;
+	normalize_vector(sumvect1 , size);
+
+	for(unsigned int i = 1 ; i < set2.size() ; i++){
+
+		vect = get(set2[i].c_str());
+
+		if(vect != nullptr){add_vector(sumvect2 , vect , size);}
+
+	}
+
+	normalize_vector(sumvect2 , size);
+
+	return dot_product(sumvect1 , sumvect2 , size);
 
 }
 
@@ -483,8 +1069,8 @@ float Embedding::cosine(const std::vector<std::string> &set1 , const std::vector
 void Embedding::display_attributes(){
 
 	std::cout<<std::endl;
-	std::cout<<"Size of vocab : "<<vocab.size()<<std::endl;
-	std::cout<<"Size of M : "<<M.size()<<std::endl;
+	std::cout<<"Size of vocab : "<<nb_words<<std::endl;
+	std::cout<<"Size of M : "<<nb_words*size<<std::endl;
 	std::cout<<"Size of vectors : "<<size<<std::endl;
 	std::cout<<std::endl;
 
@@ -501,11 +1087,11 @@ void Embedding::expand_queries(std::string name_doc_queries, std::string name_do
 	bestw.resize( max_size , std::vector<char>( N , 0 ) );
 	std::vector< std::vector<char> > st;
 	st.resize( max_size , std::vector<char>( 100 , 0 ) );
-	float dist, len;
+	float dist;
 	std::vector<float> bestd(N);
 	std::vector<float> vec(max_size);
 	long long a , b, c, d, cn;
-	long long words = vocab.size();
+	long long words = nb_words;
 	std::cout<<"Size of vocab : " << words <<std::endl;
 	std::vector<long long> bi(100);
 	std::string line;
@@ -547,7 +1133,7 @@ void Embedding::expand_queries(std::string name_doc_queries, std::string name_do
 	//For each word in st check if it is in the vocabulary if a word is not in the vocabulary, the query will not be expanded
     		for (int a = 0; a < cn; a++) {
 
-      			for (b = 0; b < words; b++) if (vocab[b]==&st[a][0]) break;
+      			for (b = 0; b < words; b++) if (strcmp((*this)[b] , &st[a][0]) == 0) break;
       			if (b == words) b = -1;
       			bi[a] = b;
       			printf("\nWord: %s Position in vocabulary: %lld\n", &st[a][0], bi[a]);
@@ -568,15 +1154,19 @@ void Embedding::expand_queries(std::string name_doc_queries, std::string name_do
     		for (b = 0; b < cn; b++) {
 
       			if (bi[b] == -1) continue;
-      			for (uint64_t a = 0; a < size; a++) vec[a] += M[a + bi[b] * size];
+      			add_stored(vec.data() , bi[b]);
 
     		}
 
 	//Normalization
-    		len = 0;
-    		for (uint64_t a = 0; a < size; a++) len += vec[a] * vec[a];
-    		len = sqrt(len);
-    		for (uint64_t a = 0; a < size; a++) vec[a] /= len;
+    		normalize_vector(vec.data() , size);
+
+	//The query in the storage of the vectors
+    		std::vector<uint16_t> half_vec(storage == HALF_STORAGE ? size : 0);
+    		std::vector<int8_t> byte_vec(storage == INT8_STORAGE ? size : 0);
+    		float byte_scale = 0;
+    		if (storage == HALF_STORAGE) to_half(vec.data() , half_vec.data() , size);
+    		if (storage == INT8_STORAGE) byte_scale = to_bytes(vec.data() , byte_vec.data() , size);
 
     		for (a = 0; a < N; a++) bestd[a] = 0;
     		for (a = 0; a < N; a++) bestw[a][0] = 0;
@@ -588,10 +1178,17 @@ void Embedding::expand_queries(std::string name_doc_queries, std::string name_do
       			a = 0;
 	      		for (b = 0; b < cn; b++) if (bi[b] == c) a = 1;
 	      		if (a == 1) continue;
-	      		dist = 0;
 
 		//Compute the distance with st and check if and where it is in the top N
-	      		for (uint64_t a = 0; a < size; a++) dist += vec[a] * M[a + c * size];
+	      		if (storage == FLOAT_STORAGE) dist = dot_product(vec.data() , matrix + c * size , size);
+	      		else {
+
+				dist = stored_dot(half_vec.data() , byte_vec.data() , byte_scale , c);
+
+			//Rescoring of the similarities that could enter the top N
+				if (rescoring_margin > 0 && dist > bestd[N - 1] - rescoring_margin) dist = dot_product(vec.data() , matrix + c * size , size);
+
+	      		}
 	      		for (a = 0; a < N; a++) {
 
 				if (dist > bestd[a]) {
@@ -604,7 +1201,7 @@ void Embedding::expand_queries(std::string name_doc_queries, std::string name_do
 		  			}
 
 		  			bestd[a] = dist;
-		  			strcpy(&bestw[a][0], &(vocab[c][0]));
+		  			strcpy(&bestw[a][0], (*this)[c]);
 		  			break;
 				}
 	      		}
@@ -0,0 +1,172 @@
+#ifndef forward_index_h
+#define forward_index_h
+
+#include "document_store.h"
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+//Documents with at most this number of distinct terms are probed linearly (with SSE2 when available) instead of with a binary search
+#define short_document_size 32
+
+
+// One document of a ForwardIndex : its distinct terms in increasing order with their tf.
+// size() is the length of the document , as for a std::vector<int> , so the models can use it in place of the list of terms
+class ForwardDocument {
+
+public:
+
+	ForwardDocument(const int* terms , const int* frequencies , const size_t nb , const int length) : terms(terms) , frequencies(frequencies) , nb(nb) , length(length) {}
+
+	//Length of the document
+	size_t size()const{return length;}
+
+	//Number of distinct terms
+	size_t nb_terms()const{return nb;}
+
+	//j-th distinct term and its tf
+	int term(const size_t j)const{return terms[j];}
+
+	int tf_at(const size_t j)const{return frequencies[j];}
+
+	//Return the tf of term in the document
+	int tf(const int term)const;
+
+
+private:
+
+	const int* terms;
+
+	const int* frequencies;
+
+	size_t nb;
+
+	int length;
+
+};
+
+
+int ForwardDocument::tf(const int term)const{
+
+	if(nb <= short_document_size){
+
+		size_t j = 0;
+
+#ifdef __SSE2__
+		__m128i target = _mm_set1_epi32(term);
+
+		for( ; j + 4 <= nb ; j += 4){
+
+			int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(terms + j)) , target));
+
+			if(mask != 0){return frequencies[j + (__builtin_ctz(mask) >> 2)];}
+
+		}
+#endif
+
+		for( ; j < nb ; j++){
+
+			if(terms[j] == term){return frequencies[j];}
+
+		}
+
+		return 0;
+
+	}
+
+	const int* p = std::lower_bound(terms , terms + nb , term);
+
+	if(p == terms + nb || *p != term){return 0;}
+
+	return frequencies[p - terms];
+
+}
+
+
+
+// Forward index of a collection : for every document (numbered densely in docid order as in a DocumentStore) the runs of
+// distinct terms sorted by term id with their tf. term_freq costs O(log |d|) instead of O(|d|)
+class ForwardIndex {
+
+public:
+
+	ForwardIndex(){}
+
+	ForwardIndex(const DocumentStore &documents){build(documents);}
+
+	ForwardIndex(const std::unordered_map< int , std::vector<int> > &collection){build(DocumentStore(collection));}
+
+	void build(const DocumentStore &documents);
+
+	size_t nb_docs()const{return ids.size();}
+
+	int id(const size_t i)const{return ids[i];}
+
+	const std::vector<int>& doc_ids()const{return ids;}
+
+	ForwardDocument document(const size_t i)const{return ForwardDocument(terms.data() + offsets[i] , tfs.data() + offsets[i] , offsets[i+1] - offsets[i] , lengths[i]);}
+
+	int doc_length(const size_t i)const{return lengths[i];}
+
+
+private:
+
+	std::vector<size_t> offsets;
+
+	std::vector<int> terms;
+
+	std::vector<int> tfs;
+
+	std::vector<int> lengths;
+
+	std::vector<int> ids;
+
+};
+
+
+void ForwardIndex::build(const DocumentStore &documents){
+
+	ids = documents.doc_ids();
+
+	offsets.assign(1 , 0);
+	lengths.resize(ids.size());
+	terms.clear();
+	tfs.clear();
+
+	std::vector<int> doc;
+
+	for(unsigned int i = 0 ; i < ids.size() ; i++){
+
+		DocumentView view = documents.document(i);
+		doc.assign(view.begin() , view.end());
+		if(!view.is_sorted()){std::sort(doc.begin() , doc.end());}
+
+		lengths[i] = doc.size();
+
+		unsigned int j = 0;
+
+		while(j < doc.size()){
+
+			unsigned int end = j;
+			while(end < doc.size() && doc[end] == doc[j]){end++;}
+
+			terms.push_back(doc[j]);
+			tfs.push_back(end - j);
+
+			j = end;
+
+		}
+
+		offsets.push_back(terms.size());
+
+	}
+
+}
+
+
+#endif
@@ -2,6 +2,8 @@
 #define frequency_h
 
 #include "character.h"
+#include "document_store.h"
+#include "forward_index.h"
 #include <cstring>
 #include <vector>
 #include <unordered_map>
@@ -245,6 +247,27 @@ int term_freq(const std::vector<int> &doc , const int &term){
 
 }
 
+//Same as before but for a document of a DocumentStore , with a binary search if its terms are sorted
+int term_freq(const DocumentView &doc , const int &term){
+
+	if(doc.is_sorted()){
+
+		std::pair<const int* , const int*> range = std::equal_range(doc.begin() , doc.end() , term);
+		return range.second - range.first;
+
+	}
+
+	return std::count(doc.begin() , doc.end() , term);
+
+}
+
+//Same as before but for a document of a ForwardIndex
+int term_freq(const ForwardDocument &doc , const int &term){
+
+	return doc.tf(term);
+
+}
+
 //Return the collection frequency corresponding to the term in input
 int coll_freq(const std::unordered_map <int,int>  &cf , const int term){
 
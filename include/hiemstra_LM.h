@@ -5,14 +5,19 @@
 #include "frequency.h"
 #include "tool.h"
 #include "display.h"
+#include "inverted_index.h"
+#include "compressed_postings.h"
+#include "sharded_index.h"
+#include "pruning.h"
 #include <cstring>
 #include <cassert>
 #include <vector>
 #include <unordered_map>
 //#include <algorithm>
 
-//Same as before but with a smoothing that takes into account the collection frequency
-double Hiemstra_language_model(const std::vector<int> &query , const std::vector<int> &document , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda){
+//Same as before but with a smoothing that takes into account the collection frequency. The document is a std::vector<int> or a DocumentView
+template<typename Document>
+double Hiemstra_language_model(const std::vector<int> &query , const Document &document , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda){
 
 	size_t doc_length = document.size();
 
@@ -74,9 +79,12 @@ std::vector< std::vector< std::pair<int,double> > > Hiemstra_language_model(cons
 
 	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
 
-	auto iterator = queries.begin();
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
 
-	while(iterator != queries.end()){
+		auto iterator = queries.find(query_ids[q]);
 
 		//std::cout<<"\rProcessing query "<<i+1<<"/"<<queries.size()<<std::flush;
 
@@ -86,7 +94,433 @@ std::vector< std::vector< std::pair<int,double> > > Hiemstra_language_model(cons
 
 		}
 
-		iterator++;
+	}
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but over a document store , whose documents are read in docid order
+std::unordered_map <int,double> Hiemstra_language_model(const std::vector<int> &query , const DocumentStore &documents , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda){
+
+	std::unordered_map <int,double> list_doc;
+
+	double proba;
+
+	for(unsigned int i = 0 ; i < documents.nb_docs() ; i++){
+
+		proba = Hiemstra_language_model(query , documents.document(i) , cf , collection_size , lambda);
+		if(proba!=0){list_doc[documents.id(i)]=proba;}
+
+	}
+
+	return list_doc;
+
+}
+
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > Hiemstra_language_model(const std::unordered_map< int , std::vector<int> > &queries , const DocumentStore &documents , const std::unordered_map <int,int>  &cf , const int collection_size , const int k , const double lambda){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		if(iterator->second.size()!=0){
+
+			list_docs[iterator->first] = kfirst_docs( Hiemstra_language_model(iterator->second , documents , cf , collection_size , lambda) , k );
+
+		}
+
+	}
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but over a forward index : the tf of every term of the query is found with a binary search in the distinct terms of the document
+std::unordered_map <int,double> Hiemstra_language_model(const std::vector<int> &query , const ForwardIndex &forward_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda){
+
+	std::unordered_map <int,double> list_doc;
+
+	double proba;
+
+	for(unsigned int i = 0 ; i < forward_index.nb_docs() ; i++){
+
+		proba = Hiemstra_language_model(query , forward_index.document(i) , cf , collection_size , lambda);
+		if(proba!=0){list_doc[forward_index.id(i)]=proba;}
+
+	}
+
+	return list_doc;
+
+}
+
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > Hiemstra_language_model(const std::unordered_map< int , std::vector<int> > &queries , const ForwardIndex &forward_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k , const double lambda){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		if(iterator->second.size()!=0){
+
+			list_docs[iterator->first] = kfirst_docs( Hiemstra_language_model(iterator->second , forward_index , cf , collection_size , lambda) , k );
+
+		}
+
+	}
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but from the tf of each term of the query in the document and the length of the document
+double Hiemstra_language_model(const std::vector<int> &query , const std::vector<int> &tfs , const int doc_length , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda){
+
+	if(doc_length == 0){return 0;}
+
+	double doc_proba;
+
+	double coll_proba;
+
+	double proba = 0;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+			coll_proba =  (1 - lambda)*( (double)coll_freq(cf , query[i])/collection_size );
+
+			if(coll_proba!=0){
+
+				doc_proba = (lambda)*( (double)(tfs[i])/doc_length );
+
+
+				proba += log(1 + doc_proba/coll_proba)/log(2);
+
+			}
+
+	}
+
+	return proba;
+
+}
+
+
+
+//Same as before but over the entire collection using the inverted index : a document that contains none of the terms of the query has a score of 0 so only the postings lists of the query are read.
+//The documents are pushed into collector , which keeps the k best of them (k being the capacity of the collector).
+//Index is an InvertedIndex or a CompressedIndex
+template<typename Index>
+void Hiemstra_language_model(const std::vector<int> &query , const Index &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda , TopkCollector &collector){
+
+	double proba;
+
+	typename Index::candidate_iterator candidates(query , inverted_index);
+
+	while(candidates.next()){
+
+		proba = Hiemstra_language_model(query , candidates.tfs() , inverted_index.doc_length(candidates.doc()) , cf , collection_size , lambda);
+		if(proba!=0){collector.push(candidates.doc() , proba);}
+
+	}
+
+}
+
+
+//Same as before but the scores of all the documents are returned in a map
+std::unordered_map <int,double> Hiemstra_language_model(const std::vector<int> &query , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda){
+
+	TopkCollector collector(-1);
+
+	Hiemstra_language_model(query , inverted_index , cf , collection_size , lambda , collector);
+
+	return collector.scores();
+
+}
+
+
+
+//Same as before but with all the queries and sort documents by their score
+std::vector< std::vector< std::pair<int,double> > > Hiemstra_language_model(const std::unordered_map< int , std::vector<int> > &queries , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k , const double lambda){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel
+	{
+
+		//Every thread has its own collector and reuses it for its queries
+		TopkCollector collector(k);
+
+		#pragma omp for schedule(dynamic)
+		for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+			auto iterator = queries.find(query_ids[q]);
+
+			if(iterator->second.size()!=0){
+
+				collector.reset();
+				Hiemstra_language_model(iterator->second , inverted_index , cf , collection_size , lambda , collector);
+				list_docs[iterator->first] = collector.results();
+
+			}
+
+		}
+
+	}
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but over a sharded index for one query : the shards are searched in parallel and their k best documents are merged (see sharded_index.h).
+//cf and collection_size are the statistics of the whole collection , so the scores are the same as over a single inverted index
+std::vector< std::pair<int,double> > Hiemstra_language_model(const std::vector<int> &query , const ShardedIndex &sharded_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k , const double lambda){
+
+	return sharded_top_k(sharded_index , [&](const InvertedIndex &shard , TopkCollector &collector){Hiemstra_language_model(query , shard , cf , collection_size , lambda , collector);} , k);
+
+}
+
+
+//Same as before but with all the queries : when there are fewer queries than threads every query is searched by all the threads (one shard each) ,
+//otherwise the queries are shared between the threads and the shards of a query are searched one after the other
+std::vector< std::vector< std::pair<int,double> > > Hiemstra_language_model(const std::unordered_map< int , std::vector<int> > &queries , const ShardedIndex &sharded_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k , const double lambda){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	bool parallel_queries = (int)query_ids.size() >= available_threads();
+
+	#pragma omp parallel for schedule(dynamic) if(parallel_queries)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		const std::vector<int> &query = queries.at(query_ids[q]);
+
+		if(query.size()!=0){list_docs[query_ids[q]] = Hiemstra_language_model(query , sharded_index , cf , collection_size , k , lambda);}
+
+	}
+
+	return list_docs;
+
+}
+
+
+// Bounds of the Hiemstra score for the dynamic pruning (see pruning.h) : the contribution of a term only grows with tf/|d| , so it is bounded by
+// the largest tf/|d| of the term (in the list or in a block)
+class HiemstraBounds {
+
+public:
+
+	template<typename Index>
+	HiemstraBounds(const std::vector<int> &query , const Index &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda);
+
+	bool active(const int i)const{return coll_proba[i] != 0;}
+
+	double bound(const int i)const{return bounds[i];}
+
+	double increment(const int i , const int tf , const int doc_length)const{return log(1 + lambda*((double)tf/doc_length)/coll_proba[i])/log(2);}
+
+	double block_bound(const int i , const int , const double max_ratio)const{return log(1 + lambda*max_ratio/coll_proba[i])/log(2);}
+
+	double doc_bound(const int)const{return 0;}
+
+	double max_doc_bound()const{return 0;}
+
+	double initial_threshold()const{return -std::numeric_limits<double>::infinity();}
+
+	double score(const std::vector<int> &tfs , const int doc_length)const{return Hiemstra_language_model(query , tfs , doc_length , cf , collection_size , lambda);}
+
+
+private:
+
+	const std::vector<int> &query;
+
+	const std::unordered_map <int,int>  &cf;
+
+	int collection_size;
+
+	double lambda;
+
+	std::vector<double> coll_proba;
+
+	std::vector<double> bounds;
+
+};
+
+
+template<typename Index>
+HiemstraBounds::HiemstraBounds(const std::vector<int> &query , const Index &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda) : query(query) , cf(cf) , collection_size(collection_size) , lambda(lambda) , coll_proba(query.size() , 0) , bounds(query.size() , 0) {
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		coll_proba[i] = (1 - lambda)*( (double)coll_freq(cf , query[i])/collection_size );
+
+		if(coll_proba[i] != 0){bounds[i] = log(1 + lambda*inverted_index.max_tf_ratio(query[i])/coll_proba[i])/log(2);}
+
+	}
+
+}
+
+
+
+//Same as before but only the k best documents are returned , sorted by decreasing score.
+//The documents that cannot enter the top k are skipped with the MaxScore , WAND or Block-Max WAND strategy , the number of documents scored and of postings skipped are added to counters
+template<typename Index>
+std::vector< std::pair<int,double> > Hiemstra_language_model(const std::vector<int> &query , const Index &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda , const int k , const PruningStrategy strategy , PruningCounters &counters){
+
+	TopkCollector collector(k);
+
+	if(k == -1){
+
+		Hiemstra_language_model(query , inverted_index , cf , collection_size , lambda , collector);
+		return collector.results();
+
+	}
+
+	HiemstraBounds scorer(query , inverted_index , cf , collection_size , lambda);
+
+	pruned_top_k(query , inverted_index , scorer , collector , strategy , counters);
+
+	return collector.results();
+
+}
+
+
+
+//Same as before but with all the queries , counters[q] gets the pruning counters of the query q
+template<typename Index>
+std::vector< std::vector< std::pair<int,double> > > Hiemstra_language_model(const std::unordered_map< int , std::vector<int> > &queries , const Index &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k , const double lambda , const PruningStrategy strategy , std::vector<PruningCounters> &counters){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	counters.assign(queries.size() , PruningCounters());
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		if(iterator->second.size()!=0){
+
+			list_docs[iterator->first] = Hiemstra_language_model(iterator->second , inverted_index , cf , collection_size , lambda , k , strategy , counters[iterator->first]);
+
+		}
+
+	}
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but for several values of lambda at once : the postings lists of the query are read only once and
+//every candidate is scored for all the values of lambda. list_docs[p] gets the k best documents for lambdas[p] , sorted by decreasing score
+std::vector< std::vector< std::pair<int,double> > > Hiemstra_language_model(const std::vector<double> &lambdas , const std::vector<int> &query , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k){
+
+	std::vector<TopkCollector> collectors(lambdas.size() , TopkCollector(k));
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(lambdas.size());
+
+	//coll_proba[p][i] is the smoothed collection probability of the term i for lambdas[p]
+	std::vector< std::vector<double> > coll_proba(lambdas.size() , std::vector<double>(query.size()));
+
+	for(unsigned int p = 0 ; p < lambdas.size() ; p++){
+
+		for(unsigned int i = 0 ; i < query.size() ; i++){
+
+			coll_proba[p][i] = (1 - lambdas[p])*( (double)coll_freq(cf , query[i])/collection_size );
+
+		}
+
+	}
+
+	double doc_proba;
+
+	double proba;
+
+	int doc_length;
+
+	CandidateIterator candidates(query , inverted_index);
+
+	while(candidates.next()){
+
+		doc_length = inverted_index.doc_length(candidates.doc());
+
+		for(unsigned int p = 0 ; p < lambdas.size() ; p++){
+
+			proba = 0;
+
+			for(unsigned int i = 0 ; i < query.size() ; i++){
+
+				if(coll_proba[p][i]!=0){
+
+					doc_proba = (lambdas[p])*( (double)(candidates.tfs()[i])/doc_length );
+
+					proba += log(1 + doc_proba/coll_proba[p][i])/log(2);
+
+				}
+
+			}
+
+			if(proba!=0){collectors[p].push(candidates.doc() , proba);}
+
+		}
+
+	}
+
+	for(unsigned int p = 0 ; p < lambdas.size() ; p++){list_docs[p] = collectors[p].results();}
+
+	return list_docs;
+
+}
+
+
+
+//Same as before but with all the queries : list_docs[p][q] gets the k best documents of the query q for lambdas[p]
+std::vector< std::vector< std::vector< std::pair<int,double> > > > Hiemstra_language_model(const std::vector<double> &lambdas , const std::unordered_map< int , std::vector<int> > &queries , const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const int k){
+
+	std::vector< std::vector< std::vector< std::pair<int,double> > > > list_docs(lambdas.size() , std::vector< std::vector< std::pair<int,double> > >(queries.size()));
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+		auto iterator = queries.find(query_ids[q]);
+
+		if(iterator->second.size()!=0){
+
+			std::vector< std::vector< std::pair<int,double> > > temp = Hiemstra_language_model(lambdas , iterator->second , inverted_index , cf , collection_size , k);
+
+			for(unsigned int p = 0 ; p < lambdas.size() ; p++){list_docs[p][iterator->first].swap(temp[p]);}
+
+		}
 
 	}
 
@@ -0,0 +1,311 @@
+#ifndef impact_index_h
+#define impact_index_h
+
+#include "inverted_index.h"
+#include "frequency.h"
+#include "accumulator.h"
+#include "topk.h"
+#include "tool.h"
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <stdint.h>
+
+
+// Impact ordered index for the Hiemstra model with a fixed lambda : the contribution log(1 + doc_proba/coll_proba)/log(2) of every posting is
+// computed once and quantized to an impact between 1 and 2^bits - 1 (bits being 8 or 16) , the largest contribution of the collection getting
+// the largest impact. The postings of a term are grouped in segments of equal impact , by decreasing impact , the docids of a segment being
+// sorted. A query is then evaluated score at a time (see Hiemstra_impact_model) , from the segments with the largest impacts
+class ImpactIndex {
+
+public:
+
+	ImpactIndex() : lambda(0) , bits(0) , scale(0) , nb_postings(0) , doc_range(0) {}
+
+	ImpactIndex(const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda , const int bits){build(inverted_index , cf , collection_size , lambda , bits);}
+
+	void build(const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda , const int bits);
+
+	double get_lambda()const{return lambda;}
+
+	int get_bits()const{return bits;}
+
+	//Contribution to the score of one unit of impact
+	double impact_scale()const{return scale;}
+
+	size_t nb_terms()const{return term_segments.size() == 0 ? 0 : term_segments.size() - 1;}
+
+	//Largest docid + 1
+	size_t docs_range()const{return doc_range;}
+
+	//Number of postings of all the terms
+	size_t size()const{return nb_postings;}
+
+	//Segments of term : first_segment(term) <= s < last_segment(term)
+	size_t first_segment(const int term)const{return (term < 0 || term >= (int)nb_terms()) ? 0 : term_segments[term];}
+
+	size_t last_segment(const int term)const{return (term < 0 || term >= (int)nb_terms()) ? 0 : term_segments[term + 1];}
+
+	unsigned int segment_impact(const size_t s)const{return impacts[s];}
+
+	const int* segment_docs(const size_t s)const{return docs.data() + segment_offsets[s];}
+
+	size_t segment_size(const size_t s)const{return segment_offsets[s + 1] - segment_offsets[s];}
+
+
+private:
+
+	double lambda;
+
+	int bits;
+
+	double scale;
+
+	size_t nb_postings;
+
+	size_t doc_range;
+
+	std::vector<size_t> term_segments;
+
+	std::vector<uint16_t> impacts;
+
+	std::vector<size_t> segment_offsets;
+
+	std::vector<int> docs;
+
+};
+
+
+void ImpactIndex::build(const InvertedIndex &inverted_index , const std::unordered_map <int,int>  &cf , const int collection_size , const double lambda , const int bits){
+
+	this->lambda = lambda;
+	this->bits = bits;
+
+	size_t nb = inverted_index.nb_terms();
+
+	const std::vector<int> &ids = inverted_index.doc_ids();
+	doc_range = ids.size() == 0 ? 0 : ids.back() + 1;
+
+	//Contribution of every posting , 0 for the terms that cannot be scored
+	std::vector< std::vector<double> > contributions(nb);
+	double largest = 0;
+
+	for(unsigned int t = 0 ; t < nb ; t++){
+
+		double coll_proba = (1 - lambda)*( (double)coll_freq(cf , t)/collection_size );
+
+		if(coll_proba == 0 || lambda == 0){continue;}
+
+		const int* term_docs = inverted_index.docs(t);
+		const int* term_tfs = inverted_index.tfs(t);
+
+		contributions[t].resize(inverted_index.postings_size(t));
+
+		for(unsigned int p = 0 ; p < contributions[t].size() ; p++){
+
+			double doc_proba = lambda*( (double)term_tfs[p]/inverted_index.doc_length(term_docs[p]) );
+
+			contributions[t][p] = log(1 + doc_proba/coll_proba)/log(2);
+			largest = std::max(largest , contributions[t][p]);
+
+		}
+
+	}
+
+	const unsigned int levels = (1u << bits) - 1;
+
+	scale = largest == 0 ? 0 : largest/levels;
+
+	term_segments.assign(1 , 0);
+	impacts.clear();
+	segment_offsets.assign(1 , 0);
+	docs.clear();
+	nb_postings = 0;
+
+	std::vector< std::pair<unsigned int,int> > postings;
+
+	for(unsigned int t = 0 ; t < nb ; t++){
+
+		const int* term_docs = inverted_index.docs(t);
+
+		postings.clear();
+
+		for(unsigned int p = 0 ; p < contributions[t].size() ; p++){
+
+			unsigned int impact = (unsigned int)std::min(std::max(std::floor(contributions[t][p]/scale + 0.5) , 1.0) , (double)levels);
+
+			postings.push_back(std::make_pair(impact , term_docs[p]));
+
+		}
+
+		//Decreasing impact then increasing docid
+		std::sort(postings.begin() , postings.end() , [](const std::pair<unsigned int,int> &p1 , const std::pair<unsigned int,int> &p2){return p1.first > p2.first || (p1.first == p2.first && p1.second < p2.second);});
+
+		for(unsigned int p = 0 ; p < postings.size() ; p++){
+
+			if(p == 0 || postings[p].first != postings[p-1].first){
+
+				if(p != 0){segment_offsets.push_back(docs.size());}
+				impacts.push_back(postings[p].first);
+
+			}
+
+			docs.push_back(postings[p].second);
+
+		}
+
+		if(postings.size() != 0){segment_offsets.push_back(docs.size());}
+
+		term_segments.push_back(impacts.size());
+		nb_postings += postings.size();
+
+		std::vector<double>().swap(contributions[t]);
+
+	}
+
+}
+
+
+
+//Return false , with a message , if a limit of the evaluation over the impact ordered index is negative without being -1 (no limit)
+inline bool valid_impact_limits(const long long max_postings , const double max_seconds){
+
+	if(max_postings >= -1 && (max_seconds >= 0 || max_seconds == -1)){return true;}
+
+	std::cout<<"Invalid limits of the impact model : "<<max_postings<<" postings , "<<max_seconds<<" seconds (-1 for no limit)"<<std::endl;
+
+	return false;
+
+}
+
+
+//Hiemstra model over the impact ordered index , score at a time : the segments of the terms of the query are read by decreasing impact
+//(a term repeated in the query counting as many times) and every posting adds its impact to the accumulator of its document.
+//The evaluation stops once max_postings postings have been read or after max_seconds seconds (-1 for no limit) , the documents are
+//then pushed into collector with their accumulated score , which is the exact quantized score when no limit was reached.
+//accumulators must have a size of at least impact_index.docs_range() , return the number of postings read (0 , with nothing pushed , for a negative limit other than -1)
+size_t Hiemstra_impact_model(const std::vector<int> &query , const ImpactIndex &impact_index , ScoreAccumulator &accumulators , TopkCollector &collector , const long long max_postings , const double max_seconds){
+
+	if(!valid_impact_limits(max_postings , max_seconds)){return 0;}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	//Weight of every term of the query
+	std::unordered_map<int,int> weights;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){weights[query[i]]++;}
+
+	//Segments of the query by decreasing weighted impact
+	std::vector< std::pair<unsigned int,size_t> > segments;
+
+	for(auto iterator = weights.begin() ; iterator != weights.end() ; iterator++){
+
+		for(size_t s = impact_index.first_segment(iterator->first) ; s < impact_index.last_segment(iterator->first) ; s++){
+
+			segments.push_back(std::make_pair(impact_index.segment_impact(s)*iterator->second , s));
+
+		}
+
+	}
+
+	std::sort(segments.begin() , segments.end() , [](const std::pair<unsigned int,size_t> &s1 , const std::pair<unsigned int,size_t> &s2){return s1.first > s2.first || (s1.first == s2.first && s1.second < s2.second);});
+
+	accumulators.reset();
+
+	size_t nb_read = 0;
+	bool stopped = false;
+
+	//The clock is only read every chunk postings , since_clock counting the postings read since it was last read (across the segments)
+	const size_t chunk = 4096;
+	size_t since_clock = 0;
+
+	for(unsigned int j = 0 ; j < segments.size() && !stopped ; j++){
+
+		const int* segment = impact_index.segment_docs(segments[j].second);
+		size_t size = impact_index.segment_size(segments[j].second);
+		double impact = segments[j].first;
+
+		for(size_t begin = 0 , end = 0 ; begin < size && !stopped ; begin = end){
+
+			end = std::min(size , begin + chunk - since_clock);
+
+			if(max_postings != -1){end = std::min(end , begin + (size_t)max_postings - nb_read);}
+
+			for(size_t p = begin ; p < end ; p++){accumulators.add(segment[p] , impact);}
+
+			nb_read += end - begin;
+			since_clock += end - begin;
+
+			if(max_postings != -1 && nb_read >= (size_t)max_postings){stopped = true;}
+
+			if(since_clock < chunk){continue;}
+
+			since_clock = 0;
+
+			if(max_seconds != -1 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= max_seconds){stopped = true;}
+
+		}
+
+	}
+
+	const std::vector<int> &touched = accumulators.touched_docs();
+
+	for(unsigned int l = 0 ; l < touched.size() ; l++){collector.push(touched[l] , accumulators.value(touched[l])*impact_index.impact_scale());}
+
+	return nb_read;
+
+}
+
+
+//Same as before but the k best documents are returned , sorted by decreasing score
+std::vector< std::pair<int,double> > Hiemstra_impact_model(const std::vector<int> &query , const ImpactIndex &impact_index , const int k , const long long max_postings , const double max_seconds){
+
+	ScoreAccumulator accumulators(impact_index.docs_range());
+	TopkCollector collector(k);
+
+	Hiemstra_impact_model(query , impact_index , accumulators , collector , max_postings , max_seconds);
+
+	return collector.results();
+
+}
+
+
+//Same as before but with all the queries , every thread reusing its accumulators and its collector. nb_read[q] gets the number of postings read for the query q
+std::vector< std::vector< std::pair<int,double> > > Hiemstra_impact_model(const std::unordered_map< int , std::vector<int> > &queries , const ImpactIndex &impact_index , const int k , const long long max_postings , const double max_seconds , std::vector<size_t> &nb_read){
+
+	std::vector< std::vector< std::pair<int,double> > > list_docs(queries.size());
+
+	nb_read.assign(queries.size() , 0);
+
+	if(!valid_impact_limits(max_postings , max_seconds)){return list_docs;}
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	#pragma omp parallel
+	{
+
+		ScoreAccumulator accumulators(impact_index.docs_range());
+		TopkCollector collector(k);
+
+		#pragma omp for schedule(dynamic)
+		for(unsigned int q = 0 ; q < query_ids.size() ; q++){
+
+			auto iterator = queries.find(query_ids[q]);
+
+			collector.reset();
+			nb_read[iterator->first] = Hiemstra_impact_model(iterator->second , impact_index , accumulators , collector , max_postings , max_seconds);
+			list_docs[iterator->first] = collector.results();
+
+		}
+
+	}
+
+	return list_docs;
+
+}
+
+
+#endif
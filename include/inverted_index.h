@@ -0,0 +1,397 @@
+#ifndef inverted_index_h
+#define inverted_index_h
+
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <limits>
+#include "document_store.h"
+
+
+class CandidateIterator;
+class PostingsCursor;
+
+
+// Postings lists of (docid , tf) for every term of an indexed collection, plus the length of every document
+class InvertedIndex {
+
+public:
+
+	typedef CandidateIterator candidate_iterator;
+
+	typedef PostingsCursor cursor;
+
+	InvertedIndex(){}
+
+	InvertedIndex(const std::unordered_map< int , std::vector<int> > &collection){build(collection);}
+
+	InvertedIndex(const DocumentStore &documents){build(documents);}
+
+	//Build the postings lists from an indexed collection (as produced by read_all_info_and_index)
+	void build(const std::unordered_map< int , std::vector<int> > &collection){build(DocumentStore(collection));}
+
+	//Build the postings lists from a document store
+	void build(const DocumentStore &documents);
+
+	//Number of terms that have a postings list (the largest term id + 1)
+	size_t nb_terms()const{return offsets.size() - 1;}
+
+	//Number of documents of the collection (empty documents included)
+	size_t nb_docs()const{return ids.size();}
+
+	//Number of documents that contain term
+	size_t postings_size(const int term)const{
+
+		if(term < 0 || term >= (int)nb_terms()){return 0;}
+		return offsets[term+1] - offsets[term];
+
+	}
+
+	//Docids of the documents that contain term, in increasing order (an empty list for a term that is not in the index)
+	const int* docs(const int term)const{return postings_docs.data() + (postings_size(term) == 0 ? 0 : offsets[term]);}
+
+	//Term frequencies aligned with docs(term)
+	const int* tfs(const int term)const{return postings_tfs.data() + (postings_size(term) == 0 ? 0 : offsets[term]);}
+
+	//Return the tf of term in the document doc (binary search in the postings list)
+	int tf(const int term , const int doc)const;
+
+	//Largest tf of term in a document of the collection
+	int max_tf(const int term)const{return postings_size(term) == 0 ? 0 : max_tfs[term];}
+
+	//Largest tf/length ratio of term in a document of the collection
+	double max_tf_ratio(const int term)const{return postings_size(term) == 0 ? 0 : max_ratios[term];}
+
+	//Return the length of the document doc
+	int doc_length(const int doc)const{return lengths[doc];}
+
+	//Docids of all the documents of the collection in increasing order
+	const std::vector<int>& doc_ids()const{return ids;}
+
+	//Docids of the non empty documents sorted by increasing length
+	const std::vector<int>& docs_by_length()const{return sorted_by_length;}
+
+	//Write the index at the end of a binary image (see binary_image.h)
+	void write(BinaryImageWriter &image)const;
+
+	//Read an index written by write , return false (with an empty index) if the image is truncated or inconsistent
+	bool read(BinaryImageReader &image);
+
+
+private:
+
+	//Start of the postings list of each term in postings_docs and postings_tfs
+	std::vector<size_t> offsets;
+
+	std::vector<int> postings_docs;
+
+	std::vector<int> postings_tfs;
+
+	//Largest tf and tf/length ratio of each term , used to bound the scores
+	std::vector<int> max_tfs;
+
+	std::vector<double> max_ratios;
+
+	//Length of each document , indexed by docid
+	std::vector<int> lengths;
+
+	std::vector<int> ids;
+
+	std::vector<int> sorted_by_length;
+
+};
+
+
+void InvertedIndex::build(const DocumentStore &documents){
+
+	ids = documents.doc_ids();
+
+	int max_doc = ids.size() == 0 ? -1 : ids.back();
+	int max_term = -1;
+
+	std::vector<int> doc;
+
+	for(unsigned int i = 0 ; i < ids.size() ; i++){
+
+		DocumentView view = documents.document(i);
+
+		for(unsigned int j = 0 ; j < view.size() ; j++){
+
+			max_term = std::max(max_term , view[j]);
+
+		}
+
+	}
+
+	lengths.assign(max_doc + 1 , 0);
+
+	//Document frequency of each term
+	offsets.assign(max_term + 2 , 0);
+
+	for(unsigned int i = 0 ; i < ids.size() ; i++){
+
+		DocumentView view = documents.document(i);
+		doc.assign(view.begin() , view.end());
+		lengths[ids[i]] = doc.size();
+		if(!view.is_sorted()){std::sort(doc.begin() , doc.end());}
+
+		for(unsigned int j = 0 ; j < doc.size() ; j++){
+
+			if(j == 0 || doc[j] != doc[j-1]){offsets[doc[j]+1]++;}
+
+		}
+
+	}
+
+	for(unsigned int t = 1 ; t < offsets.size() ; t++){offsets[t] += offsets[t-1];}
+
+	postings_docs.resize(offsets.back());
+	postings_tfs.resize(offsets.back());
+
+	std::vector<size_t> position(offsets.begin() , offsets.end() - 1);
+
+	max_tfs.assign(max_term + 1 , 0);
+	max_ratios.assign(max_term + 1 , 0);
+
+	//Documents are visited in increasing docid order so every postings list ends up sorted
+	for(unsigned int i = 0 ; i < ids.size() ; i++){
+
+		DocumentView view = documents.document(i);
+		doc.assign(view.begin() , view.end());
+		if(!view.is_sorted()){std::sort(doc.begin() , doc.end());}
+
+		unsigned int j = 0;
+
+		while(j < doc.size()){
+
+			unsigned int end = j;
+			while(end < doc.size() && doc[end] == doc[j]){end++;}
+
+			postings_docs[position[doc[j]]] = ids[i];
+			postings_tfs[position[doc[j]]] = end - j;
+			position[doc[j]]++;
+
+			max_tfs[doc[j]] = std::max(max_tfs[doc[j]] , int(end - j));
+			max_ratios[doc[j]] = std::max(max_ratios[doc[j]] , double(end - j)/doc.size());
+
+			j = end;
+
+		}
+
+	}
+
+	sorted_by_length.clear();
+
+	for(unsigned int i = 0 ; i < ids.size() ; i++){
+
+		if(lengths[ids[i]] > 0){sorted_by_length.push_back(ids[i]);}
+
+	}
+
+	std::stable_sort(sorted_by_length.begin() , sorted_by_length.end() , [this](const int d1 , const int d2){return lengths[d1] < lengths[d2];});
+
+}
+
+
+void InvertedIndex::write(BinaryImageWriter &image)const{
+
+	image.write_array(offsets);
+	image.write_array(postings_docs);
+	image.write_array(postings_tfs);
+	image.write_array(max_tfs);
+	image.write_array(max_ratios);
+	image.write_array(lengths);
+	image.write_array(ids);
+	image.write_array(sorted_by_length);
+
+}
+
+
+bool InvertedIndex::read(BinaryImageReader &image){
+
+	bool ok = image.read_array(offsets) && image.read_array(postings_docs) && image.read_array(postings_tfs) && image.read_array(max_tfs) && image.read_array(max_ratios);
+
+	ok = ok && image.read_array(lengths) && image.read_array(ids) && image.read_array(sorted_by_length);
+
+	ok = ok && offsets.size() > 0 && offsets[0] == 0 && offsets.back() == postings_docs.size() && postings_docs.size() == postings_tfs.size();
+	ok = ok && max_tfs.size() == nb_terms() && max_ratios.size() == nb_terms();
+
+	//The docids are increasing and lengths is indexed by them
+	ok = ok && lengths.size() == (ids.size() == 0 ? 0 : (size_t)ids.back() + 1) && (ids.size() == 0 || ids[0] >= 0);
+
+	for(size_t i = 1 ; ok && i < ids.size() ; i++){ok = ids[i-1] < ids[i];}
+
+	//Every postings list is in postings_docs , with increasing docids of the collection
+	for(size_t t = 0 ; ok && t < nb_terms() ; t++){
+
+		ok = offsets[t] <= offsets[t+1] && offsets[t+1] <= postings_docs.size();
+
+		for(size_t l = offsets[t] ; ok && l < offsets[t+1] ; l++){
+
+			ok = postings_docs[l] >= 0 && (size_t)postings_docs[l] < lengths.size() && (l == offsets[t] || postings_docs[l-1] < postings_docs[l]);
+
+		}
+
+	}
+
+	for(size_t i = 0 ; ok && i < sorted_by_length.size() ; i++){ok = sorted_by_length[i] >= 0 && (size_t)sorted_by_length[i] < lengths.size();}
+
+	if(!ok){*this = InvertedIndex();}
+
+	return ok;
+
+}
+
+
+int InvertedIndex::tf(const int term , const int doc)const{
+
+	if(postings_size(term) == 0){return 0;}
+
+	const int* begin = docs(term);
+	const int* end = begin + postings_size(term);
+	const int* p = std::lower_bound(begin , end , doc);
+
+	if(p == end || *p != doc){return 0;}
+
+	return tfs(term)[p - begin];
+
+}
+
+
+
+// Walks the documents that contain at least one term of a query in increasing docid order
+// and gives, for each of them, the tf of every term of the query (0 when the term is absent)
+class CandidateIterator {
+
+public:
+
+	CandidateIterator(const std::vector<int> &query , const InvertedIndex &inverted_index) : query(query) , inverted_index(inverted_index) , position(query.size() , 0) , frequencies(query.size() , 0) , current(-1) {}
+
+	//Move to the next candidate document ; return false when all the postings lists have been read
+	bool next();
+
+	//Docid of the current candidate
+	int doc()const{return current;}
+
+	//tf of each term of the query in the current candidate
+	const std::vector<int>& tfs()const{return frequencies;}
+
+
+private:
+
+	const std::vector<int> &query;
+
+	const InvertedIndex &inverted_index;
+
+	std::vector<size_t> position;
+
+	std::vector<int> frequencies;
+
+	int current;
+
+};
+
+
+bool CandidateIterator::next(){
+
+	current = -1;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		if(position[i] < inverted_index.postings_size(query[i])){
+
+			int doc = inverted_index.docs(query[i])[position[i]];
+			if(current == -1 || doc < current){current = doc;}
+
+		}
+
+	}
+
+	if(current == -1){return false;}
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		frequencies[i] = 0;
+
+		if(position[i] < inverted_index.postings_size(query[i]) && inverted_index.docs(query[i])[position[i]] == current){
+
+			frequencies[i] = inverted_index.tfs(query[i])[position[i]];
+			position[i]++;
+
+		}
+
+	}
+
+	return true;
+
+}
+
+
+
+// Reads the postings list of one term , with jumps to the first document greater or equal to a given docid
+class PostingsCursor {
+
+public:
+
+	PostingsCursor(const InvertedIndex &inverted_index , const int term) : docids(inverted_index.docs(term)) , frequencies(inverted_index.tfs(term)) , size(inverted_index.postings_size(term)) , position(0) {}
+
+	//Return true once the whole postings list has been read
+	bool at_end()const{return position >= size;}
+
+	//Current docid , or INT_MAX once the whole list has been read
+	int doc()const{return at_end() ? std::numeric_limits<int>::max() : docids[position];}
+
+	int tf()const{return frequencies[position];}
+
+	void next(){position++;}
+
+	//Move to the first posting whose docid is greater or equal to target (galloping search) and return the number of postings passed over
+	size_t next_geq(const int target);
+
+	//Number of postings in the list
+	size_t length()const{return size;}
+
+
+private:
+
+	const int* docids;
+
+	const int* frequencies;
+
+	size_t size;
+
+	size_t position;
+
+};
+
+
+size_t PostingsCursor::next_geq(const int target){
+
+	size_t start = position;
+
+	if(at_end() || docids[position] >= target){return 0;}
+
+	size_t step = 1;
+	size_t low = position;
+	size_t high = position + 1;
+
+	while(high < size && docids[high] < target){
+
+		low = high;
+		step *= 2;
+		high = position + step;
+
+	}
+
+	if(high > size){high = size;}
+
+	position = std::lower_bound(docids + low , docids + high , target) - docids;
+
+	return position - start;
+
+}
+
+
+#endif
@@ -3,10 +3,14 @@
 
 
 #include "readwrite.h"
+#include "binary_index.h"
 #include "basic_LM.h"
 #include "hiemstra_LM.h"
 #include "dirichlet_LM.h"
+#include "impact_index.h"
+#include "vector_kernels.h"
 #include "display.h"
+#include "neighbor_lists.h"
 #include <cstring>
 #include <vector>
 #include <unordered_map>
@@ -15,98 +19,144 @@
 
 
 //Performs a set of experiments with a "regular" model
+//All the values of lambda are scored in a single pass over the postings lists of each query , the queries are shared between the threads
 void launch_Hiemstra_experience(const std::string &collection_file , const std::string &queries_file , const std::string &res_file , double lambda , const double lambda_step , const int k){
 
-	std::vector< std::vector< std::pair<int,double> > > results;
-	std::unordered_map< int , std::vector<int> > collection;
+	std::vector< std::vector< std::vector< std::pair<int,double> > > > results;
 	std::unordered_map< int , std::vector<int> > queries;
 	std::unordered_map <std::string,int> index;
 	std::unordered_map <int,int> cf;
-	std::string file_name;
 
-	double lambda_temp;
+	//collection_file can also be a collection image written by the "index" command (see binary_index.h)
+	DocumentStore documents;
+	InvertedIndex inverted_index;
 
-	read_all_info_and_index(collection_file , queries_file , collection , queries , index , cf);
+	if(!read_indexed_collection(collection_file , queries_file , documents , inverted_index , queries , index , cf)){return;}
 
 	size_t nb_words = get_size_collection(cf);
 
 	unsigned int nb_iter = floor(1.0/lambda_step) + 1;
 
-	int nthreads, tid;
+	std::vector<double> lambdas(nb_iter);
+
+	for(unsigned int current_iter = 0 ; current_iter < nb_iter ; current_iter++){lambdas[current_iter] = lambda + lambda_step*current_iter;}
+
+	std::vector<std::string> file_names(nb_iter , res_file);
+
+	for(unsigned int current_iter = 0 ; current_iter < nb_iter ; current_iter++){file_names[current_iter] += std::to_string(lambdas[current_iter]);}
+
+	std::vector<int> query_ids = queries_by_length(queries);
 
-	#pragma omp parallel private( file_name , lambda_temp , results , tid) shared(lambda)
-	{
+	std::cout<<"Number of thread: "<<omp_get_max_threads()<<std::endl;
 
-		tid = omp_get_thread_num();
+	//The full rankings are written as soon as a query is finished instead of being kept for all the queries
+	if(k == -1){
 
-        //std::cout<<"Thread No "<<tid<<std::endl;
-        if (tid == 0)
-        {
-            nthreads = omp_get_num_threads();
-            std::cout<<"Number of thread: "<<nthreads<<std::endl;
-        }
+		RunWriter writer(file_names , "CHIC-" , lambdas);
 
+		#pragma omp parallel for schedule(dynamic)
+		for(unsigned int i = 0 ; i < query_ids.size() ; i++){
 
-		#pragma omp for schedule(static)
-		for(unsigned int current_iter = 0 ; current_iter < nb_iter ; current_iter++){
+			const std::vector<int> &query = queries.at(query_ids[i]);
 
-			lambda_temp += lambda + lambda_step*current_iter;
-			results = Hiemstra_language_model(queries , collection , cf , nb_words , k , lambda_temp);
-			file_name = res_file;
-			file_name += std::to_string(lambda_temp);
-			write_res_file(results , file_name , "CHIC-" , lambda_temp);
+			if(query.size() == 0){continue;}
+
+			writer.write(query_ids[i] , Hiemstra_language_model(lambdas , query , inverted_index , cf , nb_words , k));
 
 		}
+
+		return;
+
+	}
+
+	results.assign(nb_iter , std::vector< std::vector< std::pair<int,double> > >(queries.size()));
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int i = 0 ; i < query_ids.size() ; i++){
+
+		const std::vector<int> &query = queries.at(query_ids[i]);
+
+		if(query.size() == 0){continue;}
+
+		std::vector< std::vector< std::pair<int,double> > > temp = Hiemstra_language_model(lambdas , query , inverted_index , cf , nb_words , k);
+
+		for(unsigned int current_iter = 0 ; current_iter < nb_iter ; current_iter++){results[current_iter][query_ids[i]].swap(temp[current_iter]);}
+
+	}
+
+	#pragma omp parallel for schedule(static)
+	for(unsigned int current_iter = 0 ; current_iter < nb_iter ; current_iter++){
+
+		write_res_file(results[current_iter] , file_names[current_iter] , "CHIC-" , lambdas[current_iter]);
+
 	}
+
 }
 
 
 
 
 //Performs a set of experiments with an embedded model
+//All the values of mu are scored in a single pass over the postings lists of each query , the queries are shared between the threads
 void launch_Dirichlet_experience(const std::string &collection_file , const std::string &queries_file , const std::string &res_file , double &mu , const double &mu_step , const int nb_iter , const int k ){
 
-	std::vector< std::vector< std::pair<int,double> > > results;
-	std::unordered_map< int , std::vector<int> > collection;
+	std::vector< std::vector< std::vector< std::pair<int,double> > > > results;
 	std::unordered_map< int , std::vector<int> > queries;
 	std::unordered_map <std::string,int> index;
 	std::unordered_map <int,int> cf;
-	std::string file_name;
 
-	double mu_temp;
+	//collection_file can also be a collection image written by the "index" command (see binary_index.h)
+	DocumentStore documents;
+	InvertedIndex inverted_index;
 
-	read_all_info_and_index(collection_file , queries_file , collection , queries , index , cf);
+	if(!read_indexed_collection(collection_file , queries_file , documents , inverted_index , queries , index , cf)){return;}
 
 	size_t nb_words = get_size_collection(cf);
 
-	int nthreads, tid;
+	std::vector<double> mus(nb_iter);
+
+	for(int current_iter = 0 ; current_iter < nb_iter ; current_iter++){mus[current_iter] = mu + mu_step*current_iter;}
+
+	std::vector<std::string> file_names(nb_iter , res_file);
+
+	for(int current_iter = 0 ; current_iter < nb_iter ; current_iter++){file_names[current_iter] += std::to_string(mus[current_iter]);}
 
-	#pragma omp parallel private( file_name , mu_temp , results , tid) shared(mu , mu_step)
-	{
+	std::vector<int> query_ids = queries_by_length(queries);
 
-		tid = omp_get_thread_num();
+	std::cout<<"Number of thread: "<<omp_get_max_threads()<<std::endl;
 
-        //std::cout<<"Thread No "<<tid<<std::endl;
-        if (tid == 0)
-        {
-            nthreads = omp_get_num_threads();
-            std::cout<<"Number of thread: "<<nthreads<<std::endl;
-        }
+	//The full rankings are written as soon as a query is finished instead of being kept for all the queries
+	if(k == -1){
 
+		RunWriter writer(file_names , "CHIC-" , mus);
 
-		#pragma omp for schedule(static)
-		for(int current_iter = 0 ; current_iter < nb_iter ; current_iter++){
+		#pragma omp parallel for schedule(dynamic)
+		for(unsigned int i = 0 ; i < query_ids.size() ; i++){
 
-			mu_temp = mu + mu_step*(current_iter);
-			results = Dirichlet_language_model(mu_temp , queries , collection , cf , k , nb_words);
-			file_name = res_file;
-			file_name += std::to_string(mu_temp);
-			write_res_file(results , file_name , "CHIC-" , mu_temp);
-			//mu += mu_step;
-			//current_iter++;
+			writer.write(query_ids[i] , Dirichlet_language_model(mus , queries.at(query_ids[i]) , inverted_index , cf , nb_words , k));
 
 		}
 
+		return;
+
+	}
+
+	results.assign(nb_iter , std::vector< std::vector< std::pair<int,double> > >(queries.size()));
+
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int i = 0 ; i < query_ids.size() ; i++){
+
+		std::vector< std::vector< std::pair<int,double> > > temp = Dirichlet_language_model(mus , queries.at(query_ids[i]) , inverted_index , cf , nb_words , k);
+
+		for(int current_iter = 0 ; current_iter < nb_iter ; current_iter++){results[current_iter][query_ids[i]].swap(temp[current_iter]);}
+
+	}
+
+	#pragma omp parallel for schedule(static)
+	for(int current_iter = 0 ; current_iter < nb_iter ; current_iter++){
+
+		write_res_file(results[current_iter] , file_names[current_iter] , "CHIC-" , mus[current_iter]);
+
 	}
 
 }
@@ -114,8 +164,442 @@ void launch_Dirichlet_experience(const std::string &collection_file , const std:
 
 
 
-//Performs a set of experiments with an embedded model
-void launch_embedded_experience(const std::string &collection_file , const std::string &queries_file , const std::string &index_file , const std::string &res_file , const std::string &collection_cosine_file , const std::string &queries_cosine_file , const double &mu , const double &mu_step , const int &nb_iter_mu , const int k , const double &threshold, const double &threshold_step , const int &nb_iter_threshold , const double &alpha, const double &alpha_step , const int &nb_iter_alpha ){
+//Compares the codecs of the compressed postings lists (see compressed_postings.h) on the collection : size in bits per posting (docids , tfs and skip data) ,
+//encoding and decoding throughput , the time of the Dirichlet model with k = 1000 over the compressed index against the uncompressed one , and the time
+//of the Dirichlet and Hiemstra models with WAND and Block-Max WAND over the compressed index. Every ranking is checked against the exhaustive
+//one over the uncompressed index and the number of queries whose ranking differs is displayed
+void launch_compression_benchmark(const std::string &collection_file , const std::string &queries_file , const double &mu){
+
+	std::unordered_map< int , std::vector<int> > queries;
+	std::unordered_map <std::string,int> index;
+	std::unordered_map <int,int> cf;
+
+	DocumentStore documents;
+	InvertedIndex inverted_index;
+
+	if(!read_indexed_collection(collection_file , queries_file , documents , inverted_index , queries , index , cf)){return;}
+
+	size_t nb_words = get_size_collection(cf);
+	const int k = 1000;
+
+	std::vector<int> query_ids = queries_by_length(queries);
+
+	size_t nb_postings = 0;
+	for(unsigned int t = 0 ; t < inverted_index.nb_terms() ; t++){nb_postings += inverted_index.postings_size(t);}
+
+	std::cout<<"Postings : "<<nb_postings<<" , uncompressed : "<<(double)(2*sizeof(int)*8)<<" bits per posting"<<std::endl;
+
+	TopkCollector collector(k);
+	std::vector< std::vector< std::pair<int,double> > > reference(query_ids.size());
+
+	clock_t begin = clock();
+
+	for(unsigned int i = 0 ; i < query_ids.size() ; i++){
+
+		collector.reset();
+		Dirichlet_language_model(mu , queries.at(query_ids[i]) , inverted_index , cf , nb_words , collector);
+		reference[i] = collector.results();
+
+	}
+
+	std::cout<<"Dirichlet over the uncompressed index : "<<double(clock() - begin) / CLOCKS_PER_SEC<<" s"<<std::endl;
+
+	//Exhaustive Hiemstra rankings , against which the pruned ones are checked
+	std::vector< std::vector< std::pair<int,double> > > hiemstra_reference(query_ids.size());
+
+	for(unsigned int i = 0 ; i < query_ids.size() ; i++){
+
+		collector.reset();
+		Hiemstra_language_model(queries.at(query_ids[i]) , inverted_index , cf , nb_words , 0.5 , collector);
+		hiemstra_reference[i] = collector.results();
+
+	}
+
+	const PostingsCodec codecs[3] = {VBYTE , PFOR_DELTA , BIT_PACKING};
+	const std::string names[3] = {"VByte" , "PForDelta" , "Bit packing"};
+
+	for(int c = 0 ; c < 3 ; c++){
+
+		begin = clock();
+
+		CompressedIndex compressed_index(inverted_index , codecs[c]);
+
+		double encode_secs = double(clock() - begin) / CLOCKS_PER_SEC;
+
+		//Every list is read to the end , reading the tfs so that they are decoded too
+		begin = clock();
+
+		long long checksum = 0;
+
+		for(unsigned int t = 0 ; t < compressed_index.nb_terms() ; t++){
+
+			for(CompressedCursor cursor(compressed_index , t) ; !cursor.at_end() ; cursor.next()){checksum += cursor.doc() + cursor.tf();}
+
+		}
+
+		double decode_secs = double(clock() - begin) / CLOCKS_PER_SEC;
+
+		begin = clock();
+
+		size_t nb_different = 0;
+
+		for(unsigned int i = 0 ; i < query_ids.size() ; i++){
+
+			collector.reset();
+			Dirichlet_language_model(mu , queries.at(query_ids[i]) , compressed_index , cf , nb_words , collector);
+			if(collector.results() != reference[i]){nb_different++;}
+
+		}
+
+		double query_secs = double(clock() - begin) / CLOCKS_PER_SEC;
+
+		std::cout<<names[c]<<" : "<<8.0*compressed_index.size_in_bytes()/std::max(nb_postings , (size_t)1)<<" bits per posting , encoding "<<nb_postings/std::max(encode_secs , 1e-9)/1e6<<" M postings/s , decoding "<<nb_postings/std::max(decode_secs , 1e-9)/1e6<<" M postings/s (checksum "<<checksum<<") , Dirichlet : "<<query_secs<<" s";
+		std::cout<<" , "<<nb_different<<" queries with a different ranking"<<std::endl;
+
+		//Dynamic pruning over the compressed index : WAND with the bounds of the whole lists against Block-Max WAND
+		const PruningStrategy strategies[2] = {WAND , BLOCK_MAX_WAND};
+		const std::string strategy_names[2] = {"WAND" , "Block-Max WAND"};
+
+		for(int s = 0 ; s < 2 ; s++){
+
+			PruningCounters dirichlet_counters , hiemstra_counters;
+
+			size_t dirichlet_different = 0 , hiemstra_different = 0;
+
+			begin = clock();
+
+			for(unsigned int i = 0 ; i < query_ids.size() ; i++){
+
+				if(Dirichlet_language_model(mu , queries.at(query_ids[i]) , compressed_index , cf , nb_words , k , strategies[s] , dirichlet_counters) != reference[i]){dirichlet_different++;}
+
+			}
+
+			double dirichlet_secs = double(clock() - begin) / CLOCKS_PER_SEC;
+
+			begin = clock();
+
+			for(unsigned int i = 0 ; i < query_ids.size() ; i++){
+
+				if(Hiemstra_language_model(queries.at(query_ids[i]) , compressed_index , cf , nb_words , 0.5 , k , strategies[s] , hiemstra_counters) != hiemstra_reference[i]){hiemstra_different++;}
+
+			}
+
+			double hiemstra_secs = double(clock() - begin) / CLOCKS_PER_SEC;
+
+			std::cout<<"    "<<strategy_names[s]<<" : Dirichlet "<<dirichlet_secs<<" s ("<<dirichlet_counters.nb_scored<<" documents scored , "<<dirichlet_counters.nb_rejected<<" rejected , "<<dirichlet_different<<" queries with a different ranking) , Hiemstra "<<hiemstra_secs<<" s ("<<hiemstra_counters.nb_scored<<" documents scored , "<<hiemstra_counters.nb_rejected<<" rejected , "<<hiemstra_different<<" queries with a different ranking)"<<std::endl;
+
+		}
+
+	}
+
+}
+
+
+
+
+//Evaluates the queries with the Hiemstra model over impact ordered indexes (8 and 16 bits impacts) , without limit then with limits on the number
+//of postings read and on the time of a query. For every setting , the run is written in res_file followed by the setting , and the mean time
+//and the mean overlap of the k best documents with the exhaustive ranking are displayed
+void launch_impact_experience(const std::string &collection_file , const std::string &queries_file , const std::string &res_file , const double lambda , const int k){
+
+	std::unordered_map< int , std::vector<int> > queries;
+	std::unordered_map <std::string,int> index;
+	std::unordered_map <int,int> cf;
+
+	DocumentStore documents;
+	InvertedIndex inverted_index;
+
+	if(!read_indexed_collection(collection_file , queries_file , documents , inverted_index , queries , index , cf)){return;}
+
+	size_t nb_words = get_size_collection(cf);
+
+	std::vector< std::vector< std::pair<int,double> > > reference = Hiemstra_language_model(queries , inverted_index , cf , nb_words , k , lambda);
+
+	//Limits : number of postings (-1 for none) and seconds (-1 for none)
+	const long long postings_limits[6] = {-1 , 100000 , 10000 , 1000 , -1 , -1};
+	const double time_limits[6] = {-1 , -1 , -1 , -1 , 0.01 , 0.001};
+
+	const int impact_bits[2] = {8 , 16};
+
+	for(int b = 0 ; b < 2 ; b++){
+
+		clock_t begin = clock();
+
+		ImpactIndex impact_index(inverted_index , cf , nb_words , lambda , impact_bits[b]);
+
+		std::cout<<impact_bits[b]<<" bits impacts , "<<impact_index.size()<<" postings , built in "<<double(clock() - begin) / CLOCKS_PER_SEC<<" s"<<std::endl;
+
+		for(int l = 0 ; l < 6 ; l++){
+
+			std::vector<size_t> nb_read;
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			std::vector< std::vector< std::pair<int,double> > > results = Hiemstra_impact_model(queries , impact_index , k , postings_limits[l] , time_limits[l] , nb_read);
+
+			double elapsed_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			double overlap = 0;
+			size_t postings = 0;
+
+			for(unsigned int q = 0 ; q < results.size() ; q++){
+
+				overlap += ranking_overlap(results[q] , reference[q]);
+				postings += nb_read[q];
+
+			}
+
+			std::string setting = std::to_string(impact_bits[b]) + "bits_" + std::to_string(postings_limits[l]) + "postings_" + std::to_string(time_limits[l]) + "s";
+
+			write_res_file(results , res_file + setting , "CHIC-" , lambda);
+
+			std::cout<<"    max postings "<<postings_limits[l]<<" , max time "<<time_limits[l]<<" s : "<<1000*elapsed_secs/std::max(results.size() , (size_t)1)<<" ms per query (all threads) , ";
+			std::cout<<(double)postings/std::max(results.size() , (size_t)1)<<" postings read per query , overlap with the exhaustive top "<<k<<" : "<<overlap/std::max(results.size() , (size_t)1)<<std::endl;
+
+		}
+
+	}
+
+}
+
+
+
+
+//Speed of the dot products of the embeddings : a vector is compared to nb_vectors normalized random vectors (as in closest_terms) ,
+//nb_repeats times , with the kernels of every instruction set supported by the processor , the scalar one being the loop used before
+//the kernels. 301 is a size without a kernel of constant length
+void launch_kernels_benchmark(const int nb_vectors , const int nb_repeats){
+
+	std::cout<<"Kernels of the processor : "<<kernel_name(kernel_level())<<std::endl;
+
+	const size_t sizes[4] = {100 , 300 , 768 , 301};
+
+	srand(0);
+
+	for(int s = 0 ; s < 4 ; s++){
+
+		const size_t size = sizes[s];
+
+		std::vector<float> matrix((size_t)nb_vectors*size);
+
+		for(unsigned int i = 0 ; i < matrix.size() ; i++){matrix[i] = (float)rand()/RAND_MAX - 0.5f;}
+
+		for(int v = 0 ; v < nb_vectors ; v++){normalize_vector(&matrix[(size_t)v*size] , size);}
+
+		const float* query = matrix.data();
+
+		std::vector<float> reference(nb_vectors);
+
+		for(int v = 0 ; v < nb_vectors ; v++){reference[v] = dot_product_scalar(query , &matrix[(size_t)v*size] , size);}
+
+		const double flops = 2.0*size*nb_vectors*nb_repeats;
+
+		std::cout<<"Size "<<size<<" :"<<std::endl;
+
+		for(int level = SCALAR_KERNELS ; level <= (int)kernel_level() ; level++){
+
+			float checksum = 0;
+			float max_difference = 0;
+
+			clock_t begin = clock();
+
+			for(int r = 0 ; r < nb_repeats ; r++){
+
+				for(int v = 0 ; v < nb_vectors ; v++){
+
+					const float* vector = &matrix[(size_t)v*size];
+
+					float dist = dot_product(query , vector , size , (KernelLevel)level);
+
+					checksum += dist;
+
+					if(r == 0){max_difference = std::max(max_difference , std::abs(dist - reference[v]));}
+
+				}
+
+			}
+
+			double secs = std::max(double(clock() - begin) / CLOCKS_PER_SEC , 1e-9);
+
+			std::cout<<"    "<<kernel_name((KernelLevel)level)<<" : "<<flops/secs/1e9<<" GFLOP/s , max difference with the scalar loop "<<max_difference<<" (checksum "<<checksum<<")"<<std::endl;
+
+		}
+
+	}
+
+}
+
+
+
+//Quantized storages of the embeddings : for every storage , the memory of its vectors , the largest error of the cosine over nb_pairs random
+//pairs of words , the time of a scan of the vocabulary and the time of closest_terms for the nb_terms first words against the nb_vocabulary first words , without then with the
+//rescoring margin. The closest terms are compared to the ones of the float vectors
+void launch_quantization_benchmark(const std::string &word2vec_file , const std::string &cache_file , const int nb_vocabulary , const int nb_terms , const size_t nb_pairs , const double threshold , const float margin){
+
+	Embedding embedding;
+
+	if(embedding.load(word2vec_file , cache_file) != 0 || embedding.size_voc() == 0){std::cout<<"Could not read the embeddings "<<word2vec_file<<std::endl; return;}
+
+	std::unordered_map<std::string,int> vocabulary;
+	std::vector<std::string> terms;
+
+	for(unsigned int i = 0 ; i < std::min((size_t)nb_vocabulary , embedding.size_voc()) ; i++){vocabulary[embedding[i]] = i;}
+
+	for(unsigned int i = 0 ; i < std::min((size_t)nb_terms , embedding.size_voc()) ; i++){terms.push_back(embedding[i]);}
+
+	std::vector< std::unordered_map<std::string,double> > reference(terms.size());
+
+	const EmbeddingStorage storages[3] = {FLOAT_STORAGE , HALF_STORAGE , INT8_STORAGE};
+	const std::string names[3] = {"float" , "half" , "int8"};
+
+	for(int s = 0 ; s < 3 ; s++){
+
+		embedding.quantize(storages[s] , true);
+
+		//Similarities of the first word with all the vocabulary , without the lookups of the words , so that only the vectors are read
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		float checksum = 0;
+
+		for(unsigned int id = 0 ; id < embedding.size_voc() ; id++){checksum += embedding.similarity(0 , id , threshold);}
+
+		double scan_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout<<names[s]<<" : "<<embedding.storage_bytes()/1e6<<" MB , max cosine error "<<embedding.max_cosine_error(nb_pairs)<<" , scan of the vocabulary "<<1000*scan_secs<<" ms (checksum "<<checksum<<")"<<std::endl;
+
+		//The float vectors have no rescoring
+		const float margins[2] = {0 , margin};
+
+		for(int m = 0 ; m < (s == 0 ? 1 : 2) ; m++){
+
+			embedding.set_rescoring_margin(margins[m]);
+
+			size_t nb_closest = 0 , nb_different = 0;
+
+			start = std::chrono::steady_clock::now();
+
+			for(unsigned int t = 0 ; t < terms.size() ; t++){
+
+				std::unordered_map<std::string,double> most_sim = closest_terms(terms[t] , vocabulary , embedding , threshold);
+
+				if(s == 0){reference[t] = most_sim;}
+
+				nb_closest += most_sim.size();
+
+				for(auto iterator = most_sim.begin() ; iterator != most_sim.end() ; iterator++){if(reference[t].count(iterator->first) == 0){nb_different++;}}
+
+				for(auto iterator = reference[t].begin() ; iterator != reference[t].end() ; iterator++){if(most_sim.count(iterator->first) == 0){nb_different++;}}
+
+			}
+
+			double elapsed_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			std::cout<<"    rescoring margin "<<margins[m]<<" : closest terms in "<<elapsed_secs<<" s , "<<nb_closest<<" closest terms , "<<nb_different<<" differences with the float vectors"<<std::endl;
+
+		}
+
+	}
+
+	embedding.set_rescoring_margin(0);
+	embedding.quantize(FLOAT_STORAGE , true);
+
+}
+
+
+
+//Name of the translated index of threshold written by launch_translated_index_build
+std::string translated_index_file(const std::string &translated_file , const double threshold){return translated_file + "_" + std::to_string(threshold);}
+
+
+//Read the translated index of threshold written by launch_translated_index_build , return false if there is none , if it was not built
+//from source_files as they are now , if its documents are not the ones of inverted_index or if it does not have the lists of all the terms of the queries
+bool read_translated_index(const std::string &translated_file , const double threshold , const std::vector<std::string> &source_files , const InvertedIndex &inverted_index , const std::vector<int> &query_terms , TranslatedIndex &translated_index){
+
+	if(translated_file.empty()){return false;}
+
+	TranslatedIndex temp;
+
+	std::string file_name = translated_index_file(translated_file , threshold);
+
+	if(!temp.read(file_name , source_files) || temp.get_threshold() != threshold){return false;}
+
+	bool same_documents = temp.doc_ids() == inverted_index.doc_ids();
+
+	for(unsigned int i = 0 ; same_documents && i < temp.doc_ids().size() ; i++){same_documents = temp.doc_length(temp.doc_ids()[i]) == inverted_index.doc_length(temp.doc_ids()[i]);}
+
+	if(!same_documents){std::cout<<"The translated index "<<file_name<<" was built from another collection , it is not used"<<std::endl; return false;}
+
+	for(unsigned int i = 0 ; i < query_terms.size() ; i++){if(!temp.has_term(query_terms[i])){return false;}}
+
+	std::swap(translated_index , temp);
+
+	return true;
+
+}
+
+
+//Build offline the translated index of the terms of the queries for every threshold of the sweep of launch_embedded_experience and write
+//it in translated_index_file(translated_file , threshold) , to be read by launch_embedded_experience instead of being translated again
+void launch_translated_index_build(const std::string &collection_file , const std::string &queries_file , const std::string &index_file , const std::string &collection_cosine_file , const std::string &queries_cosine_file , const std::string &translated_file , const double &threshold , const double &threshold_step , const int &nb_iter_threshold){
+
+	std::unordered_map< int , std::unordered_map<int,double> > all_cos;
+	std::unordered_map<int,double> all_sum_cos;
+	std::unordered_map< int , std::vector<int> > collection;
+	std::unordered_map< int , std::vector<int> > queries;
+	std::unordered_map <std::string,int> index;
+	std::unordered_map <int,int> cf;
+
+	double threshold_max = threshold+threshold_step*(nb_iter_threshold-1);
+
+	read_all_info_and_index2( collection_file , queries_file , index_file , collection_cosine_file , queries_cosine_file , collection , queries , index, cf , all_cos , all_sum_cos , threshold);
+
+	NeighborLists neighbor_lists(all_cos);
+
+	DocumentStore documents(collection);
+	std::unordered_map< int , std::vector<int> >().swap(collection);
+
+	InvertedIndex inverted_index(documents);
+
+	std::vector<int> query_terms;
+
+	for(auto iterator = queries.begin() ; iterator != queries.end() ; iterator++){query_terms.insert(query_terms.end() , iterator->second.begin() , iterator->second.end());}
+
+	//The files the indexes are built from , checked when they are read
+	std::vector<std::string> source_files = {collection_file , queries_file , index_file , collection_cosine_file , queries_cosine_file};
+
+	TranslationMatrix translation_matrix;
+
+	TranslationMatrix previous_matrix;
+
+	TranslatedIndex translated_index;
+
+	for(int current_iter_threshold = 0 ; current_iter_threshold < nb_iter_threshold ; current_iter_threshold++ ){
+
+		double threshold_temp = threshold_max - current_iter_threshold*threshold_step;
+
+		std::swap(previous_matrix , translation_matrix);
+		translation_matrix.build(neighbor_lists , threshold_temp);
+
+		if(current_iter_threshold == 0){translated_index.build(inverted_index , translation_matrix , threshold_temp , query_terms);}
+
+		else{translated_index.update(inverted_index , previous_matrix , translation_matrix , threshold_temp);}
+
+		std::string file_name = translated_index_file(translated_file , threshold_temp);
+
+		if(!translated_index.write(file_name , source_files)){std::cout<<"Could not write "<<file_name<<std::endl; return;}
+
+		std::cout<<"Translated index of the threshold "<<threshold_temp<<" written in "<<file_name<<std::endl;
+
+	}
+
+}
+
+
+
+
+//Performs a set of experiments with an embedded model. The translated indexes written by launch_translated_index_build in translated_file
+//are read when they exist (translated_file can be empty)
+void launch_embedded_experience(const std::string &collection_file , const std::string &queries_file , const std::string &index_file , const std::string &res_file , const std::string &collection_cosine_file , const std::string &queries_cosine_file , const std::string &translated_file , const double &mu , const double &mu_step , const int &nb_iter_mu , const int k , const double &threshold, const double &threshold_step , const int &nb_iter_threshold , const double &alpha, const double &alpha_step , const int &nb_iter_alpha ){
 
 	std::unordered_map< int , std::unordered_map<int,double> > all_cos;
 	std::unordered_map<int,double> all_sum_cos;
@@ -128,53 +612,116 @@ void launch_embedded_experience(const std::string &collection_file , const std::
 
 	double threshold_max = threshold+threshold_step*(nb_iter_threshold-1);
 
-	read_all_info_and_index2( collection_file , queries_file , index_file , collection_cosine_file , queries_cosine_file , collection , queries , index, cf , all_cos , all_sum_cos , threshold_max);
+	//The cosine files are read once with the lowest threshold of the sweep , every other threshold keeps a prefix of the lists
+	read_all_info_and_index2( collection_file , queries_file , index_file , collection_cosine_file , queries_cosine_file , collection , queries , index, cf , all_cos , all_sum_cos , threshold);
+
+	NeighborLists neighbor_lists(all_cos);
+
+	//The collection is only kept in contiguous form
+	DocumentStore documents(collection);
+	std::unordered_map< int , std::vector<int> >().swap(collection);
+
+	InvertedIndex inverted_index(documents);
+
+	//Only the translated lists of the terms of the queries are materialized
+	std::vector<int> query_terms;
+
+	for(auto iterator = queries.begin() ; iterator != queries.end() ; iterator++){query_terms.insert(query_terms.end() , iterator->second.begin() , iterator->second.end());}
 
 	size_t nb_words = get_size_collection(cf);
 
-	int nthreads;
+	std::vector<double> mus(nb_iter_mu);
 
-	#pragma omp parallel private( all_cos , all_sum_cos )
-	{
+	for(int current_iter_mu = 0 ; current_iter_mu < nb_iter_mu ; current_iter_mu++){mus[current_iter_mu] = mu + mu_step*current_iter_mu;}
 
-		int tid = omp_get_thread_num();
+	std::vector<int> query_ids = queries_by_length(queries);
 
-		//std::cout<<"Thread No "<<tid<<std::endl;
-		if (tid == 0)
-		{
-			nthreads = omp_get_num_threads();
-			std::cout<<"Number of thread: "<<nthreads<<std::endl;
-		}
+	std::cout<<"Number of thread: "<<omp_get_max_threads()<<std::endl;
+
+	//The files the translated indexes must have been built from
+	std::vector<std::string> source_files = {collection_file , queries_file , index_file , collection_cosine_file , queries_cosine_file};
+
+	TranslationMatrix translation_matrix;
+
+	TranslationMatrix previous_matrix;
+
+	TranslatedIndex translated_index;
+
+	//The translation masses only depend on the threshold and alpha : they are computed once per query for every pair and shared by all the values of mu
+	for(int current_iter_threshold = 0 ; current_iter_threshold < nb_iter_threshold ; current_iter_threshold++ ){
+
+		double threshold_temp = threshold_max - current_iter_threshold*threshold_step;
+
+		std::swap(previous_matrix , translation_matrix);
+		translation_matrix.build(neighbor_lists , threshold_temp);
+
+		if(read_translated_index(translated_file , threshold_temp , source_files , inverted_index , query_terms , translated_index)){std::cout<<"Translated index of the threshold "<<threshold_temp<<" read"<<std::endl;}
+
+		else if(current_iter_threshold == 0){translated_index.build(inverted_index , translation_matrix , threshold_temp , query_terms);}
+
+		else{translated_index.update(inverted_index , previous_matrix , translation_matrix , threshold_temp);}
 
-		#pragma omp for schedule(static) collapse(3)
-		for(int current_iter_threshold = 0 ; current_iter_threshold < nb_iter_threshold ; current_iter_threshold++ ){
+		for(int current_iter_alpha = 0  ; current_iter_alpha < nb_iter_alpha ; current_iter_alpha++ ){
 
-			for(int current_iter_alpha = 0  ; current_iter_alpha < nb_iter_alpha ; current_iter_alpha++ ){
+			double alpha_temp = alpha + current_iter_alpha*alpha_step;
 
-				for(int current_iter_mu = 0 ; current_iter_mu < nb_iter_mu ; current_iter_mu++){
+			std::vector<std::string> file_names(nb_iter_mu);
 
-					double threshold_temp = threshold_max - current_iter_threshold*threshold_step;
+			for(int current_iter_mu = 0 ; current_iter_mu < nb_iter_mu ; current_iter_mu++){
 
-					double mu_temp = mu + mu_step*current_iter_mu;
+				std::string file_name = res_file;
+				file_name += std::to_string(mus[current_iter_mu]);
+				file_name.erase (file_name.size()-4,4);
+				file_name += "|";
+				file_name += std::to_string(threshold_temp);
+				file_name.erase (file_name.size()-4,4);
+				file_name += "|";
+				file_name += std::to_string(alpha_temp);
+				file_name.erase (file_name.size()-4,4);
+				file_names[current_iter_mu] = file_name;
 
-					double alpha_temp = alpha + current_iter_alpha*alpha_step;
+			}
+
+			//The full rankings are written as soon as a query is finished instead of being kept for all the queries
+			if(k == -1){
+
+				RunWriter writer(file_names , "CHIC-" , mus);
+
+				#pragma omp parallel for schedule(dynamic)
+				for(unsigned int i = 0 ; i < query_ids.size() ; i++){
+
+					TranslationCache cache(queries.at(query_ids[i]) , translated_index , cf , nb_words , alpha_temp , k);
 
-					delete_low_similarities(collection_cosine_file , queries_cosine_file , all_cos , all_sum_cos , threshold_temp);
-					std::vector< std::vector< std::pair<int,double> > > results = Dirichlet_embedding_model(mu_temp , queries , collection , cf , all_sum_cos , all_cos , k , nb_words , alpha_temp);
-					std::cout<< "Performed all the queries for mu = "<<mu_temp<< " , for alpha = "<< alpha_temp <<" and the threshold = " << threshold_temp <<std::endl;
-					std::string file_name = res_file;
-					file_name += std::to_string(mu_temp);
-					file_name.erase (file_name.size()-4,4);
-					file_name += "|";
-					file_name += std::to_string(threshold_temp);
-					file_name.erase (file_name.size()-4,4);
-					file_name += "|";
-					file_name += std::to_string(alpha_temp);
-					file_name.erase (file_name.size()-4,4);
-					write_res_file(results , file_name , "CHIC-" , mu_temp);
+					writer.write(query_ids[i] , Dirichlet_embedding_model(mus , cache , k));
 
 				}
 
+				std::cout<< "Performed all the queries for alpha = "<< alpha_temp <<" and the threshold = " << threshold_temp <<std::endl;
+
+				continue;
+
+			}
+
+			std::vector< std::vector< std::vector< std::pair<int,double> > > > results(nb_iter_mu , std::vector< std::vector< std::pair<int,double> > >(queries.size()));
+
+			#pragma omp parallel for schedule(dynamic)
+			for(unsigned int i = 0 ; i < query_ids.size() ; i++){
+
+				TranslationCache cache(queries.at(query_ids[i]) , translated_index , cf , nb_words , alpha_temp , k);
+
+				std::vector< std::vector< std::pair<int,double> > > temp = Dirichlet_embedding_model(mus , cache , k);
+
+				for(int current_iter_mu = 0 ; current_iter_mu < nb_iter_mu ; current_iter_mu++){results[current_iter_mu][query_ids[i]].swap(temp[current_iter_mu]);}
+
+			}
+
+			std::cout<< "Performed all the queries for alpha = "<< alpha_temp <<" and the threshold = " << threshold_temp <<std::endl;
+
+			#pragma omp parallel for schedule(static)
+			for(int current_iter_mu = 0 ; current_iter_mu < nb_iter_mu ; current_iter_mu++){
+
+				write_res_file(results[current_iter_mu] , file_names[current_iter_mu] , "CHIC-" , mus[current_iter_mu]);
+
 			}
 
 		}
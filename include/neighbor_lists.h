@@ -0,0 +1,166 @@
+#ifndef neighbor_lists_h
+#define neighbor_lists_h
+
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <functional>
+
+
+// Similar terms of every term of the vocabulary sorted by decreasing cosine similarity, plus the prefix sums of the similarities.
+// Keeping the similarities greater than a threshold only means keeping a prefix of every list, so a sweep over thresholds
+// can be done from one read of the cosine files
+class NeighborLists {
+
+public:
+
+	NeighborLists(){}
+
+	NeighborLists(const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map){build(cosine_map);}
+
+	//Build the lists from the similarities read by read_indexed_cos (with the lowest threshold of the sweep)
+	void build(const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map);
+
+	//Number of terms that have a list (the largest term id + 1)
+	size_t nb_terms()const{return offsets.size() - 1;}
+
+	//Return true if term was in the cosine files (its list may be empty)
+	bool has_term(const int term)const{return term >= 0 && term < (int)nb_terms() && present[term];}
+
+	//Similar terms of term , by decreasing similarity
+	const int* neighbors(const int term)const{return ids.data() + offsets[term];}
+
+	//Similarities aligned with neighbors(term)
+	const double* similarities(const int term)const{return cosines.data() + offsets[term];}
+
+	//Number of similar terms of term whose similarity is greater than threshold
+	size_t prefix_length(const int term , const double &threshold)const;
+
+	//Sum of the similarities of the first length similar terms of term
+	double prefix_sum(const int term , const size_t length)const{return sums[offsets[term] + term + length];}
+
+	//Sum of the similarities greater than threshold of term
+	double sum_cos(const int term , const double &threshold)const{return has_term(term) ? prefix_sum(term , prefix_length(term , threshold)) : 0;}
+
+	//Fill the maps as delete_low_similarities would , from the lists in memory instead of the cosine files
+	void select(const double &threshold , std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , std::unordered_map<int,double> &sum_cosine_map)const;
+
+
+private:
+
+	//Start of the list of each term in ids and cosines
+	std::vector<size_t> offsets;
+
+	std::vector<int> ids;
+
+	std::vector<double> cosines;
+
+	//Prefix sums of each list , with a leading 0 : the sums of the term t start at offsets[t] + t
+	std::vector<double> sums;
+
+	std::vector<bool> present;
+
+};
+
+
+void NeighborLists::build(const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map){
+
+	int max_term = -1;
+
+	auto iterator = cosine_map.begin();
+
+	while(iterator != cosine_map.end()){
+
+		max_term = std::max(max_term , iterator->first);
+		iterator++;
+
+	}
+
+	offsets.assign(max_term + 2 , 0);
+	present.assign(max_term + 1 , false);
+
+	for(iterator = cosine_map.begin() ; iterator != cosine_map.end() ; iterator++){
+
+		offsets[iterator->first + 1] = iterator->second.size();
+		present[iterator->first] = true;
+
+	}
+
+	for(unsigned int t = 1 ; t < offsets.size() ; t++){offsets[t] += offsets[t-1];}
+
+	ids.resize(offsets.back());
+	cosines.resize(offsets.back());
+	sums.assign(offsets.back() + nb_terms() , 0);
+
+	std::vector< std::pair<double,int> > row;
+
+	for(iterator = cosine_map.begin() ; iterator != cosine_map.end() ; iterator++){
+
+		row.clear();
+
+		for(auto iterator2 = iterator->second.begin() ; iterator2 != iterator->second.end() ; iterator2++){
+
+			row.push_back(std::make_pair(iterator2->second , iterator2->first));
+
+		}
+
+		//Decreasing similarity , ties on the term id so that the lists do not depend on the hash order
+		std::sort(row.begin() , row.end() , [](const std::pair<double,int> &p1 , const std::pair<double,int> &p2){return p1.first > p2.first || (p1.first == p2.first && p1.second < p2.second);});
+
+		size_t start = offsets[iterator->first];
+		size_t sum_start = start + iterator->first;
+
+		for(unsigned int j = 0 ; j < row.size() ; j++){
+
+			ids[start + j] = row[j].second;
+			cosines[start + j] = row[j].first;
+			sums[sum_start + j + 1] = sums[sum_start + j] + row[j].first;
+
+		}
+
+	}
+
+}
+
+
+size_t NeighborLists::prefix_length(const int term , const double &threshold)const{
+
+	if(!has_term(term)){return 0;}
+
+	const double* begin = similarities(term);
+	const double* end = cosines.data() + offsets[term+1];
+
+	//First similarity lower or equal to the threshold
+	return std::lower_bound(begin , end , threshold , std::greater<double>()) - begin;
+
+}
+
+
+void NeighborLists::select(const double &threshold , std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , std::unordered_map<int,double> &sum_cosine_map)const{
+
+	cosine_map.clear();
+	sum_cosine_map.clear();
+
+	size_t length;
+
+	for(unsigned int t = 0 ; t < nb_terms() ; t++){
+
+		if(!present[t]){continue;}
+
+		length = prefix_length(t , threshold);
+
+		std::unordered_map<int,double> &row = cosine_map[t];
+		row.reserve(length);
+
+		for(unsigned int j = 0 ; j < length ; j++){row[neighbors(t)[j]] = similarities(t)[j];}
+
+		sum_cosine_map[t] = prefix_sum(t , length);
+
+	}
+
+}
+
+
+#endif
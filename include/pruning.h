@@ -0,0 +1,456 @@
+#ifndef pruning_h
+#define pruning_h
+
+#include "inverted_index.h"
+#include "compressed_postings.h"
+#include "topk.h"
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+// Document-at-a-time evaluation of a query with dynamic pruning (MaxScore , WAND and Block-Max WAND) , over an InvertedIndex or a CompressedIndex.
+// The model is given by a Scorer that provides :
+//   active(i)              : true if the term i of the query contributes to the score
+//   bound(i)               : upper bound of the contribution of the term i when it is in the document
+//   increment(i , tf , L)  : contribution of the term i when its tf in a document of length L is tf
+//   doc_bound(L)           : part of the score shared by all the documents of length L (0 if none)
+//   max_doc_bound()        : largest doc_bound over the collection
+//   initial_threshold()    : score that the k-th document is known to reach before any document is read
+//   score(tfs , L)         : exact score of a document
+//   block_bound(i , max_tf , max_ratio) : upper bound of the contribution of the term i in a block of postings whose largest tf is max_tf
+//                                         and largest tf/length ratio is max_ratio
+// so that score(tfs , L) <= doc_bound(L) + sum of the increments of the terms in the document , and doc_bound decreases with L.
+
+
+//BLOCK_MAX_WAND needs the per-block bounds of a CompressedIndex , it is the same as WAND over an InvertedIndex
+enum PruningStrategy { MAXSCORE , WAND , BLOCK_MAX_WAND };
+
+
+// Number of documents scored or rejected and of postings skipped during the evaluation of a query
+struct PruningCounters {
+
+	PruningCounters() : nb_postings(0) , nb_scored(0) , nb_rejected(0) , nb_skipped_postings(0) {}
+
+	//Total number of postings of the terms of the query
+	size_t nb_postings;
+
+	//Documents whose score has been computed
+	size_t nb_scored;
+
+	//Candidate documents whose upper bound could not reach the threshold , they are not scored
+	size_t nb_rejected;
+
+	//Postings passed over by the cursors (next_geq) without their document being a candidate
+	size_t nb_skipped_postings;
+
+};
+
+
+//Margin used when comparing an upper bound to the threshold so that rounding errors never prune a document of the top k
+inline double pruning_margin(const double threshold){return 1e-9*(1 + std::fabs(threshold));}
+
+
+//Score the document doc whose terms tf are in tfs (0 for the missing terms) if its upper bound can reach the threshold
+template<typename Scorer , typename Index>
+void evaluate_candidate(const int doc , const std::vector<int> &tfs , const double bound , const Index &inverted_index , const Scorer &scorer , TopkCollector &collector , PruningCounters &counters){
+
+	double threshold = std::max(collector.threshold() , scorer.initial_threshold());
+
+	if(bound < threshold - pruning_margin(threshold)){
+
+		counters.nb_rejected++;
+		return;
+
+	}
+
+	double proba = scorer.score(tfs , inverted_index.doc_length(doc));
+	counters.nb_scored++;
+
+	if(proba != 0){collector.push(doc , proba);}
+
+}
+
+
+//Evaluate the query with the WAND algorithm : the cursors are kept sorted by docid and the first document
+//whose accumulated upper bound can reach the threshold (the pivot) is the next one to be scored
+template<typename Scorer , typename Index>
+void wand_top_k(const std::vector<int> &query , const Index &inverted_index , const Scorer &scorer , TopkCollector &collector , PruningCounters &counters){
+
+	std::vector<typename Index::cursor> cursors;
+	std::vector<int> positions;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		if(scorer.active(i) && inverted_index.postings_size(query[i]) > 0){
+
+			cursors.push_back(typename Index::cursor(inverted_index , query[i]));
+			positions.push_back(i);
+			counters.nb_postings += inverted_index.postings_size(query[i]);
+
+		}
+
+	}
+
+	std::vector<int> order(cursors.size());
+	for(unsigned int j = 0 ; j < order.size() ; j++){order[j] = j;}
+
+	std::vector<int> tfs(query.size() , 0);
+
+	while(true){
+
+		//Insertion sort : the order barely changes from one step to the next
+		for(unsigned int j = 1 ; j < order.size() ; j++){
+
+			int current = order[j];
+			int l = j;
+			while(l > 0 && cursors[order[l-1]].doc() > cursors[current].doc()){order[l] = order[l-1]; l--;}
+			order[l] = current;
+
+		}
+
+		double threshold = std::max(collector.threshold() , scorer.initial_threshold());
+
+		double accumulated = scorer.max_doc_bound();
+		int pivot = -1;
+
+		for(unsigned int j = 0 ; j < order.size() && !cursors[order[j]].at_end() ; j++){
+
+			accumulated += scorer.bound(positions[order[j]]);
+
+			if(accumulated >= threshold - pruning_margin(threshold)){pivot = j; break;}
+
+		}
+
+		if(pivot == -1){break;}
+
+		int pivot_doc = cursors[order[pivot]].doc();
+
+		if(cursors[order[0]].doc() == pivot_doc){
+
+			int length = inverted_index.doc_length(pivot_doc);
+			double bound = scorer.doc_bound(length);
+			int nb_matched = 0;
+
+			for(unsigned int j = 0 ; j < order.size() && cursors[order[j]].doc() == pivot_doc ; j++){
+
+				tfs[positions[order[j]]] = cursors[order[j]].tf();
+				bound += scorer.increment(positions[order[j]] , cursors[order[j]].tf() , length);
+				nb_matched++;
+
+			}
+
+			evaluate_candidate(pivot_doc , tfs , bound , inverted_index , scorer , collector , counters);
+
+			for(int j = 0 ; j < nb_matched ; j++){
+
+				tfs[positions[order[j]]] = 0;
+				cursors[order[j]].next();
+
+			}
+
+		}
+
+		else{
+
+			//No document before the pivot can reach the threshold
+			for(int j = 0 ; j < pivot ; j++){
+
+				counters.nb_skipped_postings += cursors[order[j]].next_geq(pivot_doc);
+
+			}
+
+		}
+
+	}
+
+	for(unsigned int j = 0 ; j < cursors.size() ; j++){
+
+		if(!cursors[j].at_end()){counters.nb_skipped_postings += cursors[j].next_geq(std::numeric_limits<int>::max());}
+
+	}
+
+}
+
+
+//Evaluate the query with the MaxScore algorithm : the terms whose upper bounds cannot reach the threshold together
+//(the non essential terms) are only looked up for the documents found in the postings lists of the other terms
+template<typename Scorer , typename Index>
+void maxscore_top_k(const std::vector<int> &query , const Index &inverted_index , const Scorer &scorer , TopkCollector &collector , PruningCounters &counters){
+
+	std::vector<typename Index::cursor> cursors;
+	std::vector<int> positions;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		if(scorer.active(i) && inverted_index.postings_size(query[i]) > 0){
+
+			cursors.push_back(typename Index::cursor(inverted_index , query[i]));
+			positions.push_back(i);
+			counters.nb_postings += inverted_index.postings_size(query[i]);
+
+		}
+
+	}
+
+	//Terms sorted by increasing upper bound
+	std::vector<int> order(cursors.size());
+	for(unsigned int j = 0 ; j < order.size() ; j++){order[j] = j;}
+	std::sort(order.begin() , order.end() , [&](const int j1 , const int j2){return scorer.bound(positions[j1]) < scorer.bound(positions[j2]);});
+
+	//Upper bound of a document that only contains the terms order[0] ... order[j]
+	std::vector<double> accumulated(order.size());
+	double sum = scorer.max_doc_bound();
+
+	for(unsigned int j = 0 ; j < order.size() ; j++){
+
+		sum += scorer.bound(positions[order[j]]);
+		accumulated[j] = sum;
+
+	}
+
+	unsigned int first_essential = 0;
+
+	std::vector<int> tfs(query.size() , 0);
+
+	while(true){
+
+		double threshold = std::max(collector.threshold() , scorer.initial_threshold());
+
+		while(first_essential < order.size() && accumulated[first_essential] < threshold - pruning_margin(threshold)){first_essential++;}
+
+		if(first_essential == order.size()){break;}
+
+		int doc = std::numeric_limits<int>::max();
+
+		for(unsigned int j = first_essential ; j < order.size() ; j++){doc = std::min(doc , cursors[order[j]].doc());}
+
+		if(doc == std::numeric_limits<int>::max()){break;}
+
+		int length = inverted_index.doc_length(doc);
+		double bound = scorer.doc_bound(length);
+
+		for(unsigned int j = first_essential ; j < order.size() ; j++){
+
+			if(cursors[order[j]].doc() == doc){
+
+				tfs[positions[order[j]]] = cursors[order[j]].tf();
+				bound += scorer.increment(positions[order[j]] , cursors[order[j]].tf() , length);
+				cursors[order[j]].next();
+
+			}
+
+		}
+
+		for(unsigned int j = 0 ; j < first_essential ; j++){bound += scorer.bound(positions[order[j]]);}
+
+		//Look up the non essential terms , from the largest upper bound , while the document can still reach the threshold
+		for(int j = first_essential - 1 ; j >= 0 && bound >= threshold - pruning_margin(threshold) ; j--){
+
+			bound -= scorer.bound(positions[order[j]]);
+
+			counters.nb_skipped_postings += cursors[order[j]].next_geq(doc);
+
+			if(cursors[order[j]].doc() == doc){
+
+				tfs[positions[order[j]]] = cursors[order[j]].tf();
+				bound += scorer.increment(positions[order[j]] , cursors[order[j]].tf() , length);
+				cursors[order[j]].next();
+
+			}
+
+		}
+
+		evaluate_candidate(doc , tfs , bound , inverted_index , scorer , collector , counters);
+
+		for(unsigned int i = 0 ; i < tfs.size() ; i++){tfs[i] = 0;}
+
+	}
+
+	for(unsigned int j = 0 ; j < cursors.size() ; j++){
+
+		if(!cursors[j].at_end()){counters.nb_skipped_postings += cursors[j].next_geq(std::numeric_limits<int>::max());}
+
+	}
+
+}
+
+
+//Evaluate the query with the Block-Max WAND algorithm : once WAND has found a pivot , the cursors up to the pivot are moved to the block that
+//can hold it without decoding it. If the bounds of these blocks (and the shortest document among them) cannot reach the threshold , no document
+//before the end of the first of these blocks can , and the cursors are moved past it
+template<typename Scorer>
+void block_max_wand_top_k(const std::vector<int> &query , const CompressedIndex &compressed_index , const Scorer &scorer , TopkCollector &collector , PruningCounters &counters){
+
+	std::vector<CompressedCursor> cursors;
+	std::vector<int> positions;
+
+	for(unsigned int i = 0 ; i < query.size() ; i++){
+
+		if(scorer.active(i) && compressed_index.postings_size(query[i]) > 0){
+
+			cursors.push_back(CompressedCursor(compressed_index , query[i]));
+			positions.push_back(i);
+			counters.nb_postings += compressed_index.postings_size(query[i]);
+
+		}
+
+	}
+
+	std::vector<int> order(cursors.size());
+	for(unsigned int j = 0 ; j < order.size() ; j++){order[j] = j;}
+
+	std::vector<int> tfs(query.size() , 0);
+
+	//Bound of the block reached by every cursor , recomputed only when the cursor reaches another block
+	std::vector<double> block_bounds(cursors.size() , 0);
+	std::vector<size_t> bounded_blocks(cursors.size() , std::numeric_limits<size_t>::max());
+
+	//Same for the part of the bound given by the shortest document of the blocks
+	int bounded_length = -1;
+	double length_bound = 0;
+
+	while(true){
+
+		for(unsigned int j = 1 ; j < order.size() ; j++){
+
+			int current = order[j];
+			int l = j;
+			while(l > 0 && cursors[order[l-1]].doc() > cursors[current].doc()){order[l] = order[l-1]; l--;}
+			order[l] = current;
+
+		}
+
+		double threshold = std::max(collector.threshold() , scorer.initial_threshold());
+
+		double accumulated = scorer.max_doc_bound();
+		int pivot = -1;
+
+		for(unsigned int j = 0 ; j < order.size() && !cursors[order[j]].at_end() ; j++){
+
+			accumulated += scorer.bound(positions[order[j]]);
+
+			if(accumulated >= threshold - pruning_margin(threshold)){pivot = j; break;}
+
+		}
+
+		if(pivot == -1){break;}
+
+		int pivot_doc = cursors[order[pivot]].doc();
+
+		//The cursors on the pivot document after the pivot also contribute to it
+		while(pivot + 1 < (int)order.size() && cursors[order[pivot + 1]].doc() == pivot_doc){pivot++;}
+
+		double block_bound = 0;
+		int min_length = std::numeric_limits<int>::max();
+
+		for(int j = 0 ; j <= pivot ; j++){
+
+			CompressedCursor &cursor = cursors[order[j]];
+
+			cursor.shallow_next_geq(pivot_doc);
+
+			if(bounded_blocks[order[j]] != cursor.current_block()){
+
+				bounded_blocks[order[j]] = cursor.current_block();
+				block_bounds[order[j]] = scorer.block_bound(positions[order[j]] , cursor.block_max_tf() , cursor.block_max_ratio());
+
+			}
+
+			block_bound += block_bounds[order[j]];
+			min_length = std::min(min_length , cursor.block_min_length());
+
+		}
+
+		if(min_length != bounded_length){
+
+			bounded_length = min_length;
+			length_bound = scorer.doc_bound(min_length);
+
+		}
+
+		block_bound += length_bound;
+
+		if(block_bound < threshold - pruning_margin(threshold)){
+
+			//The next document that can reach the threshold is after the first of the blocks or in a list after the pivot
+			int next = std::numeric_limits<int>::max();
+
+			for(int j = 0 ; j <= pivot ; j++){next = std::min(next , cursors[order[j]].block_last_doc());}
+
+			if(next != std::numeric_limits<int>::max()){next++;}
+
+			if(pivot + 1 < (int)order.size()){next = std::min(next , cursors[order[pivot + 1]].doc());}
+
+			for(int j = 0 ; j <= pivot ; j++){counters.nb_skipped_postings += cursors[order[j]].next_geq(next);}
+
+		}
+
+		else if(cursors[order[0]].doc() == pivot_doc){
+
+			int length = compressed_index.doc_length(pivot_doc);
+			double bound = scorer.doc_bound(length);
+			int nb_matched = 0;
+
+			for(unsigned int j = 0 ; j < order.size() && cursors[order[j]].doc() == pivot_doc ; j++){
+
+				tfs[positions[order[j]]] = cursors[order[j]].tf();
+				bound += scorer.increment(positions[order[j]] , cursors[order[j]].tf() , length);
+				nb_matched++;
+
+			}
+
+			evaluate_candidate(pivot_doc , tfs , bound , compressed_index , scorer , collector , counters);
+
+			for(int j = 0 ; j < nb_matched ; j++){
+
+				tfs[positions[order[j]]] = 0;
+				cursors[order[j]].next();
+
+			}
+
+		}
+
+		else{
+
+			for(int j = 0 ; j <= pivot && cursors[order[j]].doc() < pivot_doc ; j++){
+
+				counters.nb_skipped_postings += cursors[order[j]].next_geq(pivot_doc);
+
+			}
+
+		}
+
+	}
+
+	for(unsigned int j = 0 ; j < cursors.size() ; j++){
+
+		if(!cursors[j].at_end()){counters.nb_skipped_postings += cursors[j].next_geq(std::numeric_limits<int>::max());}
+
+	}
+
+}
+
+
+//An InvertedIndex has no per-block bounds
+template<typename Scorer>
+void block_max_wand_top_k(const std::vector<int> &query , const InvertedIndex &inverted_index , const Scorer &scorer , TopkCollector &collector , PruningCounters &counters){
+
+	wand_top_k(query , inverted_index , scorer , collector , counters);
+
+}
+
+
+//Evaluate the query with the given strategy
+template<typename Scorer , typename Index>
+void pruned_top_k(const std::vector<int> &query , const Index &inverted_index , const Scorer &scorer , TopkCollector &collector , const PruningStrategy strategy , PruningCounters &counters){
+
+	if(strategy == BLOCK_MAX_WAND){block_max_wand_top_k(query , inverted_index , scorer , collector , counters);}
+
+	else if(strategy == WAND){wand_top_k(query , inverted_index , scorer , collector , counters);}
+
+	else{maxscore_top_k(query , inverted_index , scorer , collector , counters);}
+
+}
+
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef ranking_h
+#define ranking_h
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+//Below this number of documents a ranking is sorted by a single thread
+#define parallel_ranking_size 65536
+
+
+//Encode a score in an unsigned integer that has the same order : the sign bit of the positive scores is set , all the bits of the negative ones are flipped
+inline uint64_t encode_score(const double score){
+
+	uint64_t bits;
+	std::memcpy(&bits , &score , sizeof(double));
+
+	return (bits >> 63) ? ~bits : bits | ((uint64_t)1 << 63);
+
+}
+
+
+//Score of a flipped encoded score (see radix_sort_ranking)
+inline double ranking_score(const uint64_t key){
+
+	uint64_t bits = ~key;
+	bits = (bits >> 63) ? bits & ~((uint64_t)1 << 63) : ~bits;
+
+	double score;
+	std::memcpy(&score , &bits , sizeof(double));
+
+	return score;
+
+}
+
+
+//Byte at shift of the key of the i-th document : its docid or its encoded score
+inline unsigned int radix_digit(const std::vector<uint64_t> &keys , const std::vector<int> &docs , const size_t i , const unsigned int shift , const bool on_docs){
+
+	return on_docs ? ((uint32_t)docs[i] >> shift) & 255 : (keys[i] >> shift) & 255;
+
+}
+
+
+//One pass of the LSD radix sort : stable scatter of the documents on one byte of their docid or of their encoded score.
+//Every thread counts a contiguous slice of the input so that the scatter keeps the order of the input
+void radix_pass(const std::vector<uint64_t> &keys , const std::vector<int> &docs , std::vector<uint64_t> &sorted_keys , std::vector<int> &sorted_docs , const unsigned int shift , const bool on_docs , const int nb_threads , std::vector<size_t> &counts){
+
+	size_t n = keys.size();
+
+	counts.assign(256*nb_threads , 0);
+
+	#pragma omp parallel num_threads(nb_threads) if(nb_threads > 1)
+	{
+
+#ifdef _OPENMP
+		int thread = omp_get_thread_num();
+		int nb = omp_get_num_threads();
+#else
+		int thread = 0;
+		int nb = 1;
+#endif
+
+		size_t begin = n*thread/nb;
+		size_t end = n*(thread+1)/nb;
+
+		size_t* count = counts.data() + 256*thread;
+
+		for(size_t i = begin ; i < end ; i++){count[radix_digit(keys , docs , i , shift , on_docs)]++;}
+
+		#pragma omp barrier
+
+		#pragma omp single
+		{
+
+			//Exclusive prefix sums in (byte , thread) order
+			size_t total = 0;
+			size_t temp;
+
+			for(unsigned int b = 0 ; b < 256 ; b++){
+
+				for(int t = 0 ; t < nb ; t++){
+
+					temp = counts[256*t + b];
+					counts[256*t + b] = total;
+					total += temp;
+
+				}
+
+			}
+
+		}
+
+		size_t position;
+
+		for(size_t i = begin ; i < end ; i++){
+
+			position = count[radix_digit(keys , docs , i , shift , on_docs)]++;
+			sorted_keys[position] = keys[i];
+			sorted_docs[position] = docs[i];
+
+		}
+
+	}
+
+}
+
+
+//Sort a ranking by decreasing score , ties being broken on the docid (the order of TopkCollector) , with a LSD radix sort on the docids then on the encoded scores.
+//The passes on a byte that is the same for all the documents are skipped. Large rankings are sorted by all the threads unless the call is already in a parallel region
+void radix_sort_ranking(std::vector< std::pair<int,double> > &ranking){
+
+	size_t n = ranking.size();
+
+	if(n < 2){return;}
+
+	int nb_threads = 1;
+
+#ifdef _OPENMP
+	if(n >= parallel_ranking_size && !omp_in_parallel()){nb_threads = omp_get_max_threads();}
+#endif
+
+	//The scores are flipped so that the increasing order of the keys is the decreasing order of the scores
+	std::vector<uint64_t> keys(n);
+	std::vector<int> docs(n);
+
+	uint64_t keys_or = 0 , keys_and = ~(uint64_t)0;
+	uint32_t docs_or = 0 , docs_and = ~(uint32_t)0;
+
+	for(size_t i = 0 ; i < n ; i++){
+
+		keys[i] = ~encode_score(ranking[i].second);
+		docs[i] = ranking[i].first;
+
+		keys_or |= keys[i];
+		keys_and &= keys[i];
+		docs_or |= (uint32_t)docs[i];
+		docs_and &= (uint32_t)docs[i];
+
+	}
+
+	std::vector<uint64_t> sorted_keys(n);
+	std::vector<int> sorted_docs(n);
+	std::vector<size_t> counts;
+
+	//Least significant key first : the docids , then the scores
+	for(unsigned int shift = 0 ; shift < 32 ; shift += 8){
+
+		if((((docs_or ^ docs_and) >> shift) & 255) == 0){continue;}
+
+		radix_pass(keys , docs , sorted_keys , sorted_docs , shift , true , nb_threads , counts);
+		keys.swap(sorted_keys);
+		docs.swap(sorted_docs);
+
+	}
+
+	for(unsigned int shift = 0 ; shift < 64 ; shift += 8){
+
+		if((((keys_or ^ keys_and) >> shift) & 255) == 0){continue;}
+
+		radix_pass(keys , docs , sorted_keys , sorted_docs , shift , false , nb_threads , counts);
+		keys.swap(sorted_keys);
+		docs.swap(sorted_docs);
+
+	}
+
+	for(size_t i = 0 ; i < n ; i++){
+
+		ranking[i].first = docs[i];
+		ranking[i].second = ranking_score(keys[i]);
+
+	}
+
+}
+
+
+//Fraction of the documents of the reference ranking that are also in ranking (1 if the reference is empty) ,
+//used to measure how close an approximate ranking is to the exhaustive one
+double ranking_overlap(const std::vector< std::pair<int,double> > &ranking , const std::vector< std::pair<int,double> > &reference){
+
+	if(reference.size() == 0){return 1;}
+
+	std::vector<int> docs(ranking.size());
+
+	for(size_t i = 0 ; i < ranking.size() ; i++){docs[i] = ranking[i].first;}
+
+	std::sort(docs.begin() , docs.end());
+
+	size_t nb_common = 0;
+
+	for(size_t i = 0 ; i < reference.size() ; i++){
+
+		if(std::binary_search(docs.begin() , docs.end() , reference[i].first)){nb_common++;}
+
+	}
+
+	return (double)nb_common/reference.size();
+
+}
+
+
+#endif
@@ -655,45 +655,74 @@ int separate_qrel_file(const std::string &filename , const std::string &filename
 
 
 
+//Write the ranking of the i-th query at the end of a results file
+void write_res_query(std::ofstream &myfile , const std::vector< std::pair<int,double> > &ranking , const unsigned int i , const std::string &query_Id , const double &lambda){
+
+	//The queries after the 25th are numbered from 51
+	unsigned int number = i < 25 ? i+1 : i+26;
+
+	myfile.precision(17);
+
+	for(unsigned int j = 0 ; j < ranking.size() ; j++){
+
+		myfile << query_Id << std::setfill('0') << std::setw(3) << number << " Q0 "<< ranking[j].first <<" "<< j <<" "<< ranking[j].second <<" Hiemstra_LM"<<lambda<<"\n";
+
+	}
+
+}
+
+
 //Write the results in a file
 void write_res_file(const std::vector< std::vector< std::pair<int,double> > > &results , const std::string &file_name , const std::string &query_Id , const double &lambda){
 
 	std::ofstream myfile;
   	myfile.open (file_name.c_str() , std::ofstream::trunc);
 
-	int rank;
+	for(unsigned int i = 0 ; i < results.size() ; i++){write_res_query(myfile , results[i] , i , query_Id , lambda);}
 
-	for(unsigned int i = 0 ; i < results.size() ; i++){
+    myfile.close();
 
-		rank = 0;
-		if(i < 25){
+}
 
-			for(unsigned int j = 0 ; j < results[i].size() ; j++){
 
-				myfile.precision(17);
-				myfile << query_Id << std::setfill('0') << std::setw(3) << i+1 << " Q0 "<< results[i][j].first <<" "<< rank <<" "<< results[i][j].second <<" Hiemstra_LM"<<lambda<<"\n";
-				rank++;
+// Results files written query by query , one file per value of the parameter : used for the full rankings (k = -1) that are too large
+// to be kept for all the queries. The queries are written in the order they are finished , write can be called by several threads
+class RunWriter {
 
-			}
+public:
 
+	RunWriter(const std::vector<std::string> &file_names , const std::string &query_Id , const std::vector<double> &lambdas);
 
-		}
+	//Write the rankings of the i-th query , one per value of the parameter
+	void write(const unsigned int i , const std::vector< std::vector< std::pair<int,double> > > &rankings);
 
-		else{
 
-			for(unsigned int j = 0 ; j < results[i].size() ; j++){
+private:
 
-				myfile.precision(17);
-				myfile << query_Id << std::setfill('0') << std::setw(3) << i+26 << " Q0 "<< results[i][j].first <<" "<< rank <<" "<< results[i][j].second <<" Hiemstra_LM"<<lambda<<"\n";
-				rank++;
+	std::vector<std::ofstream> files;
 
-			}
+	std::string query_Id;
 
+	std::vector<double> lambdas;
 
-		}
-	}
+};
 
-    myfile.close();
+
+RunWriter::RunWriter(const std::vector<std::string> &file_names , const std::string &query_Id , const std::vector<double> &lambdas) : files(file_names.size()) , query_Id(query_Id) , lambdas(lambdas) {
+
+	for(unsigned int p = 0 ; p < file_names.size() ; p++){files[p].open(file_names[p].c_str() , std::ofstream::trunc);}
+
+}
+
+
+void RunWriter::write(const unsigned int i , const std::vector< std::vector< std::pair<int,double> > > &rankings){
+
+	#pragma omp critical(run_writer)
+	{
+
+		for(unsigned int p = 0 ; p < rankings.size() && p < files.size() ; p++){write_res_query(files[p] , rankings[p] , i , query_Id , lambdas[p]);}
+
+	}
 
 }
 
@@ -0,0 +1,96 @@
+#ifndef sharded_index_h
+#define sharded_index_h
+
+#include "inverted_index.h"
+#include "topk.h"
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+
+// Document partitioned index : the document docid belongs to the shard docid % nb_shards and every shard has its own postings lists.
+// The docids are global and the models take the statistics of the whole collection (cf and its size) , so a document gets the same score
+// in its shard as in a single index. A shard can also be built alone by streaming the text collection and written with its statistics by
+// write_shard_image (binary_index.h) , then loaded by read_shard_image and searched by another process : the k best documents of every
+// shard are then merged by pushing them into one TopkCollector
+class ShardedIndex {
+
+public:
+
+	ShardedIndex(){}
+
+	ShardedIndex(const DocumentStore &documents , const int nb_shards){build(documents , nb_shards);}
+
+	//Split the documents into nb_shards shards and build their postings lists , the shards being built in parallel
+	void build(const DocumentStore &documents , const int nb_shards);
+
+	size_t nb_shards()const{return shards.size();}
+
+	const InvertedIndex& shard(const int s)const{return shards[s];}
+
+	//Shard of the document doc
+	int shard_of(const int doc)const{return doc % (int)shards.size();}
+
+	//Number of documents of all the shards
+	size_t nb_docs()const;
+
+
+private:
+
+	std::vector<InvertedIndex> shards;
+
+};
+
+
+void ShardedIndex::build(const DocumentStore &documents , const int nb_shards){
+
+	shards.assign(nb_shards , InvertedIndex());
+
+	#pragma omp parallel for schedule(dynamic)
+	for(int s = 0 ; s < nb_shards ; s++){
+
+		DocumentStore part;
+		part.build(documents , s , nb_shards);
+		shards[s].build(part);
+
+	}
+
+}
+
+
+size_t ShardedIndex::nb_docs()const{
+
+	size_t nb = 0;
+
+	for(unsigned int s = 0 ; s < shards.size() ; s++){nb += shards[s].nb_docs();}
+
+	return nb;
+
+}
+
+
+//Return the k best documents of the sharded index , sorted by decreasing score , where score(shard , collector) pushes the documents of one shard into collector.
+//The shards are searched in parallel (unless the call is already in a parallel region) , each one into its own collector , and the collectors are merged
+template<typename Scorer>
+std::vector< std::pair<int,double> > sharded_top_k(const ShardedIndex &sharded_index , const Scorer &score , const int k){
+
+	TopkCollector collector(k);
+
+	#pragma omp parallel for schedule(dynamic) if(available_threads() > 1)
+	for(int s = 0 ; s < (int)sharded_index.nb_shards() ; s++){
+
+		TopkCollector local(k);
+
+		score(sharded_index.shard(s) , local);
+
+		#pragma omp critical(merge_top_k)
+		collector.merge(local);
+
+	}
+
+	return collector.results();
+
+}
+
+
+#endif
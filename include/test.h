@@ -10,10 +10,6 @@
 void compute_and_save_index_and_cosine(const std::string &collection_file , const std::string &queries_file , const	std::string &index_file , const	std::string &collection_cosine_file , const	std::string &queries_cosine_file , const	std::string &embeddings_file ){
 
 
-	Embedding embedding;
-
-	embedding.load_Word2VecBinFormat(embeddings_file.c_str());
-
 	std::unordered_map< int , std::vector<int> > collection;
 	std::unordered_map< int , std::vector<int> > queries;
 	std::unordered_map <std::string,int> index;
@@ -21,9 +17,17 @@ void compute_and_save_index_and_cosine(const std::string &collection_file , cons
 
 	read_all_info_and_index(collection_file , queries_file , collection , queries , index , cf);
 
-	std::cout<<"Query size : "<< queries.size() <<std::endl;
+	//Only the embeddings of the vocabulary of the collection are kept , in a file next to the index
+	std::string subset_file = index_file + ".embeddings";
+
+	//The percentages of the vocabulary and of the collection that have an embedding are displayed by extract_embeddings
+	if(extract_embeddings(embeddings_file , index , cf , subset_file) != 0){std::cout<<"Could not extract the embeddings of "<<embeddings_file<<std::endl; return;}
 
-	nb_embedded_words_in_voc(embedding , index , cf);
+	Embedding embedding;
+
+	if(!embedding.load_cache(subset_file)){std::cout<<"Could not read the embeddings "<<subset_file<<std::endl; return;}
+
+	std::cout<<"Query size : "<< queries.size() <<std::endl;
 
 	nb_embedded_words_in_queries(embedding , queries , index , true);
 
@@ -72,7 +76,54 @@ void dirichlet_test(const std::string &collection_file , const std::string &quer
 
 }
 
-void embedding_test(const std::string &collection_file , const std::string &queries_file , const std::string &index_file , const std::string &res_file , const std::string &collection_cosine_file , const std::string &queries_cosine_file){
+void compression_test(const std::string &collection_file , const std::string &queries_file){
+
+	double mu = 80;
+	launch_compression_benchmark(collection_file , queries_file , mu);
+
+}
+
+void impact_test(const std::string &collection_file , const std::string &queries_file , const std::string &res_file){
+
+	double lambda = 0.5;
+	int k = 1000;
+	launch_impact_experience(collection_file , queries_file , res_file , lambda , k);
+
+}
+
+void kernels_test(){
+
+	//The vectors stay in the cache
+	int nb_vectors = 1000;
+	int nb_repeats = 1000;
+	launch_kernels_benchmark(nb_vectors , nb_repeats);
+
+}
+
+void quantization_test(const std::string &word2vec_file , const std::string &cache_file){
+
+	int nb_vocabulary = 100000;
+	int nb_terms = 100;
+	size_t nb_pairs = 1000000;
+	double threshold = 0.4;
+	float margin = 0.02;
+	launch_quantization_benchmark(word2vec_file , cache_file , nb_vocabulary , nb_terms , nb_pairs , threshold , margin);
+
+}
+
+void translate_test(const std::string &collection_file , const std::string &queries_file , const std::string &index_file , const std::string &collection_cosine_file , const std::string &queries_cosine_file , const std::string &translated_file){
+
+	double threshold = 1.0;
+
+	double threshold_step = 0.05;
+
+	int nb_iter_threshold = 1;
+
+	launch_translated_index_build(collection_file , queries_file , index_file , collection_cosine_file , queries_cosine_file , translated_file , threshold , threshold_step , nb_iter_threshold);
+
+}
+
+void embedding_test(const std::string &collection_file , const std::string &queries_file , const std::string &index_file , const std::string &res_file , const std::string &collection_cosine_file , const std::string &queries_cosine_file , const std::string &translated_file){
 
 	int k = 1000;
 
@@ -94,7 +145,7 @@ void embedding_test(const std::string &collection_file , const std::string &quer
 
 	int nb_iter_alpha = 1;
 
-	launch_embedded_experience(collection_file , queries_file , index_file , res_file , collection_cosine_file , queries_cosine_file , mu, mu_step , nb_iter_mu, k , threshold, threshold_step ,nb_iter_threshold, alpha, alpha_step , nb_iter_alpha);
+	launch_embedded_experience(collection_file , queries_file , index_file , res_file , collection_cosine_file , queries_cosine_file , translated_file , mu, mu_step , nb_iter_mu, k , threshold, threshold_step ,nb_iter_threshold, alpha, alpha_step , nb_iter_alpha);
 
 	system("../scripts/super_trec.sh embedding");
 
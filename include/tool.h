@@ -4,6 +4,9 @@
 #include "character.h"
 #include "display.h"
 #include "embedding.h"
+#include "translation_matrix.h"
+#include "forward_index.h"
+#include "topk.h"
 #include <cmath>
 #include <utility>
 #include <cstring>
@@ -179,35 +182,42 @@ std::vector<std::string> neighbors(const std::vector<std::string> &query , const
 
 
 
-//Takes as an input an unordered map of pairs of <int,double> that correspond to the id of the documents and their associated score and returns a std::vector of pairs containing the k documents that have the highest score
-std::vector< std::pair<int,double> > kfirst_docs(const std::unordered_map<int,double> &unsorted, const int k){
+//Return the ids of the queries sorted by decreasing length (then by id) : the queries are handed out to the threads in this order
+//by a dynamic schedule , so the longest queries start first and the short ones fill the gaps at the end
+template<typename Query>
+std::vector<int> queries_by_length(const std::unordered_map< int , Query > &queries){
+
+	std::vector< std::pair<int,int> > lengths;
+
+	for(auto iterator = queries.begin() ; iterator != queries.end() ; iterator++){lengths.push_back(std::make_pair(-(int)iterator->second.size() , iterator->first));}
+
+	std::sort(lengths.begin() , lengths.end());
+
+	std::vector<int> ids(lengths.size());
+
+	for(unsigned int i = 0 ; i < lengths.size() ; i++){ids[i] = lengths[i].second;}
 
-	std::vector< std::pair<int,double> > res;
+	return ids;
+
+}
 
-	if(unsorted.size() == 0){return res;}
 
-	std::pair<int,double> temp;
+//Takes as an input an unordered map of pairs of <int,double> that correspond to the id of the documents and their associated score and returns a std::vector of pairs containing the k documents that have the highest score
+//The k best documents are selected with a bounded heap (see topk.h) , ties being broken on the docid
+std::vector< std::pair<int,double> > kfirst_docs(const std::unordered_map<int,double> &unsorted, const int k){
+
+	TopkCollector collector(k);
 
 	std::unordered_map<int,double>::const_iterator p = unsorted.begin();
 
 	while(p != unsorted.end()){
 
-		temp.first = p->first;
-		temp.second = p->second;
-		res.push_back(temp);
+		collector.push(p->first , p->second);
 		p++;
 
 	}
-	std::sort(res.begin(), res.end(),compare_pairs);
-
-	if(k != -1 && k < (int)res.size() ){
-		res.assign(res.end()-k,res.end());
 
-	}
-
-	std::reverse(res.begin() , res.end());
-
-	return res;
+	return collector.results();
 
 }
 
@@ -396,8 +406,9 @@ double translation_proba(const int term1 , const int term2 , const std::unordere
 
 
 
-//Computes the probability that term was generated by the document p(term | document)
-double proba_doc_generate_term(const int term , const std::vector<int> &document , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map ){
+//Computes the probability that term was generated by the document p(term | document) , the document is a std::vector<int> or a DocumentView
+template<typename Document>
+double proba_doc_generate_term(const int term , const Document &document , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map ){
 
 	double proba = 0;
 
@@ -414,7 +425,8 @@ double proba_doc_generate_term(const int term , const std::vector<int> &document
 
 
 //Computes the probability that term was generated by the document p(term | document) by taking into account the self translation probability
-double proba_doc_generate_term(const int term , const std::vector<int> &document , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const double &alpha ){
+template<typename Document>
+double proba_doc_generate_term(const int term , const Document &document , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const double &alpha ){
 
 	double proba = 0;
 
@@ -440,6 +452,119 @@ double proba_doc_generate_term(const int term , const std::vector<int> &document
 
 
 
+//Same as before but for a document of a ForwardIndex : every distinct term of the document is translated once and weighted by its tf
+double proba_doc_generate_term(const int term , const ForwardDocument &document , const std::unordered_map<int , double> &sum_cosine_map , const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const double &alpha ){
+
+	double proba = 0;
+
+	for(unsigned int j = 0 ; j < document.nb_terms() ; j++){
+
+		if(term == document.term(j)){
+
+			proba+= document.tf_at(j)*(alpha + (1 - alpha)*translation_proba(term , document.term(j) , sum_cosine_map , cosine_map ))/document.size();
+
+		}
+
+		else{
+
+			proba+= document.tf_at(j)*(1 - alpha)*translation_proba(term , document.term(j) , sum_cosine_map , cosine_map )/document.size();
+
+		}
+
+	}
+
+	return proba;
+
+}
+
+
+
+
+//Computes the translation probability of a term2 into term1 : p( term1 | term2 ) from the translation matrix
+inline
+double translation_proba(const int term1 , const int term2 , const TranslationMatrix &translation_matrix){
+
+	if(term1==term2){return 1;}
+
+	return translation_matrix.proba(term1 , term2);
+
+}
+
+
+
+//Computes the probability that term was generated by the document p(term | document) from the translation matrix
+template<typename Document>
+double proba_doc_generate_term(const int term , const Document &document , const TranslationMatrix &translation_matrix){
+
+	double proba = 0;
+
+	for(unsigned int i = 0 ; i < document.size() ; i++){
+
+		proba+=translation_proba(term , document[i] , translation_matrix)/document.size();
+
+	}
+
+	return proba;
+
+}
+
+
+
+//Computes the probability that term was generated by the document p(term | document) by taking into account the self translation probability , from the translation matrix
+template<typename Document>
+double proba_doc_generate_term(const int term , const Document &document , const TranslationMatrix &translation_matrix , const double &alpha ){
+
+	double proba = 0;
+
+	for(unsigned int i = 0 ; i < document.size() ; i++){
+
+		if(term == document[i]){
+
+			proba+= (alpha + (1 - alpha)*translation_proba(term , document[i] , translation_matrix))/document.size();
+
+		}
+
+		else{
+
+			proba+=(1 - alpha)*translation_proba(term , document[i] , translation_matrix)/document.size();
+
+		}
+
+	}
+
+	return proba;
+
+}
+
+
+
+//Same as before but for a document of a ForwardIndex : every distinct term of the document is translated once and weighted by its tf
+double proba_doc_generate_term(const int term , const ForwardDocument &document , const TranslationMatrix &translation_matrix , const double &alpha ){
+
+	double proba = 0;
+
+	for(unsigned int j = 0 ; j < document.nb_terms() ; j++){
+
+		if(term == document.term(j)){
+
+			proba+= document.tf_at(j)*(alpha + (1 - alpha)*translation_proba(term , document.term(j) , translation_matrix))/document.size();
+
+		}
+
+		else{
+
+			proba+= document.tf_at(j)*(1 - alpha)*translation_proba(term , document.term(j) , translation_matrix)/document.size();
+
+		}
+
+	}
+
+	return proba;
+
+}
+
+
+
 
 //Read a map and computes the sum of all the cosine similarities of a given term
 double fast_cos_sum_queries(const int query_id , const std::string &term , const std::unordered_map< int , std::unordered_map<std::string,double> > &all_cos_sum_queries){
@@ -591,7 +716,7 @@ int nb_embedded_words_in_voc(Embedding &embedding , const std::unordered_map <st
 
 	while( p!=  index.end() ){
 
-		if( embedding.get(p->first.c_str()) != nullptr ){
+		if( embedding.find(p->first.c_str()) != -1 ){
 
 			count++;
 			nb_words_emb += cf.at(p->second);
@@ -628,7 +753,7 @@ int nb_embedded_words_in_queries(Embedding &embedding , const std::unordered_map
 
 		for(unsigned int j = 0 ; j < iterator->second.size() ; j++){
 
-			if( embedding.get(iterator->second[j].c_str()) != nullptr ){
+			if( embedding.find(iterator->second[j].c_str()) != -1 ){
 				count++;
 				temp--;
 
@@ -699,7 +824,7 @@ int nb_embedded_words_in_queries(Embedding &embedding , const std::unordered_map
 
 		for(unsigned int j = 0 ; j < iterator->second.size() ; j++){
 
-			if( embedding.get(index_temp[ iterator->second[j] ].c_str()) != nullptr ){
+			if( embedding.find(index_temp[ iterator->second[j] ].c_str()) != -1 ){
 				count++;
 				temp--;
 
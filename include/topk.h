@@ -0,0 +1,174 @@
+#ifndef topk_h
+#define topk_h
+
+#include "ranking.h"
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <limits>
+#include <algorithm>
+
+
+// Keeps the k documents with the highest score seen so far in a min-heap (k = -1 keeps all of them , without a heap , and
+// the full ranking is sorted with a radix sort , see ranking.h)
+// Ties are broken on the docid : between two documents with the same score the smallest docid wins
+class TopkCollector {
+
+public:
+
+	TopkCollector(const int k) : k(k) {if(k > 0){heap.reserve(k);}}
+
+	//Number of documents to keep (-1 for all)
+	int capacity()const{return k;}
+
+	//Return true if k documents have been kept
+	bool full()const{return k != -1 && (int)heap.size() >= k;}
+
+	//Number of documents kept
+	size_t size()const{return heap.size();}
+
+	//Forget the documents kept , without releasing the memory , so that the collector can be reused for the next query
+	void reset(){heap.clear();}
+
+	//Score of the worst document kept once k documents have been kept , -infinity before (+infinity if k = 0)
+	double threshold()const{
+
+		if(k == 0){return std::numeric_limits<double>::infinity();}
+		return full() ? heap.front().second : -std::numeric_limits<double>::infinity();
+
+	}
+
+	//Offer a document to the collector
+	void push(const int doc , const double score);
+
+	//Return the documents kept , sorted by decreasing score
+	std::vector< std::pair<int,double> > results()const;
+
+	//Return the documents kept with their score
+	std::unordered_map<int,double> scores()const;
+
+	//Offer all the documents kept by other (for instance the collector of another thread)
+	void merge(const TopkCollector &other);
+
+
+private:
+
+	//Return true if p1 should be ranked before p2
+	static bool better(const std::pair<int,double> &p1 , const std::pair<int,double> &p2){return p1.second > p2.second || (p1.second == p2.second && p1.first < p2.first);}
+
+	int k;
+
+	//The worst document kept is at the front (documents in the order they were pushed if k = -1)
+	std::vector< std::pair<int,double> > heap;
+
+};
+
+
+void TopkCollector::push(const int doc , const double score){
+
+	if(k == 0){return;}
+
+	std::pair<int,double> candidate(doc , score);
+
+	if(k == -1){
+
+		heap.push_back(candidate);
+		return;
+
+	}
+
+	if(!full()){
+
+		heap.push_back(candidate);
+		std::push_heap(heap.begin() , heap.end() , better);
+
+	}
+
+	else if(better(candidate , heap.front())){
+
+		std::pop_heap(heap.begin() , heap.end() , better);
+		heap.back() = candidate;
+		std::push_heap(heap.begin() , heap.end() , better);
+
+	}
+
+}
+
+
+std::vector< std::pair<int,double> > TopkCollector::results()const{
+
+	std::vector< std::pair<int,double> > res(heap);
+
+	if(k == -1){radix_sort_ranking(res);}
+
+	else{std::sort(res.begin() , res.end() , better);}
+
+	return res;
+
+}
+
+
+std::unordered_map<int,double> TopkCollector::scores()const{
+
+	std::unordered_map<int,double> res(heap.size());
+
+	for(unsigned int i = 0 ; i < heap.size() ; i++){res[heap[i].first] = heap[i].second;}
+
+	return res;
+
+}
+
+
+void TopkCollector::merge(const TopkCollector &other){
+
+	for(unsigned int i = 0 ; i < other.heap.size() ; i++){push(other.heap[i].first , other.heap[i].second);}
+
+}
+
+
+//Number of threads of a parallel region started here (1 inside a parallel region or without OpenMP)
+inline int available_threads(){
+
+#ifdef _OPENMP
+	return omp_in_parallel() ? 1 : omp_get_max_threads();
+#else
+	return 1;
+#endif
+
+}
+
+
+//Return the k best documents of ids , sorted by decreasing score , where score(i) is the score of the i-th one (0 for a document that is not ranked).
+//The documents are split between the threads , every thread keeps the top k of its documents in its own collector and the collectors are merged at the end :
+//the result does not depend on the number of threads
+template<typename Scorer>
+std::vector< std::pair<int,double> > parallel_top_k(const std::vector<int> &ids , const Scorer &score , const int k){
+
+	TopkCollector collector(k);
+
+	#pragma omp parallel
+	{
+
+		TopkCollector local(k);
+
+		double proba;
+
+		#pragma omp for schedule(dynamic , 64) nowait
+		for(long i = 0 ; i < (long)ids.size() ; i++){
+
+			proba = score(i);
+			if(proba!=0){local.push(ids[i] , proba);}
+
+		}
+
+		#pragma omp critical(merge_top_k)
+		collector.merge(local);
+
+	}
+
+	return collector.results();
+
+}
+
+
+#endif
@@ -0,0 +1,354 @@
+#ifndef translated_index_h
+#define translated_index_h
+
+#include "inverted_index.h"
+#include "translation_matrix.h"
+#include "binary_image.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+
+// Translated postings lists of the translation language model for a fixed set of similarities (one threshold).
+// For a term q and a document d it holds tf(q,d) and the translated mass sum over w != q of p(q|w)*tf(w,d) , so that
+// p(q|d)*|d| = tf(q,d) + (1 - alpha)*translated mass for any alpha. A document is in the list of q if it contains q or a term q can be translated from
+class TranslatedIndex {
+
+public:
+
+	TranslatedIndex() : threshold(0) {}
+
+	//Materialize the translated postings lists of every term of the collection and of the translation matrix
+	void build(const InvertedIndex &inverted_index , const TranslationMatrix &translation_matrix , const double &threshold);
+
+	//Materialize only the lists of the given terms (for instance the vocabulary of the queries)
+	void build(const InvertedIndex &inverted_index , const TranslationMatrix &translation_matrix , const double &threshold , const std::vector<int> &terms);
+
+	//Rebuild the index for a new threshold : only the terms whose row changed between the two translation matrices are translated again
+	void update(const InvertedIndex &inverted_index , const TranslationMatrix &previous_matrix , const TranslationMatrix &translation_matrix , const double &threshold);
+
+	//Write the index in a binary image (see BinaryImageWriter) with the files it was built from ; return false if the file could not be written
+	bool write(const std::string &file_name , const std::vector<std::string> &source_files)const;
+
+	//Read an index written by write ; return false (leaving the index unchanged) if the file could not be read , is not a translated index ,
+	//is inconsistent , or was not built from source_files as they are now (see BinaryImageReader::read_source)
+	bool read(const std::string &file_name , const std::vector<std::string> &source_files);
+
+	//Number of terms (the largest term id + 1)
+	size_t nb_terms()const{return offsets.size() - 1;}
+
+	//Return true if the list of term has been materialized
+	bool has_term(const int term)const{return term >= 0 && term < (int)nb_terms() && materialized[term];}
+
+	//Number of documents in the translated list of term
+	size_t postings_size(const int term)const{
+
+		if(term < 0 || term >= (int)nb_terms()){return 0;}
+		return offsets[term+1] - offsets[term];
+
+	}
+
+	//Docids of the translated list of term , in increasing order
+	const int* docs(const int term)const{return postings_docs.data() + offsets[term];}
+
+	//tf(term , d) aligned with docs(term)
+	const int* tfs(const int term)const{return postings_tfs.data() + offsets[term];}
+
+	//Translated masses aligned with docs(term)
+	const float* masses(const int term)const{return postings_masses.data() + offsets[term];}
+
+	//Return the length of the document doc
+	int doc_length(const int doc)const{return lengths[doc];}
+
+	//Docids of all the documents of the collection in increasing order
+	const std::vector<int>& doc_ids()const{return ids;}
+
+	//Threshold of the similarities used to build the index
+	double get_threshold()const{return threshold;}
+
+
+private:
+
+	//Append the translated list of term to the postings
+	void translate(const int term , const InvertedIndex &inverted_index , const TranslationMatrix &translation_matrix);
+
+	//Rebuild all the lists , translating the terms for which retranslate is true and copying the others from the current lists
+	void rebuild(const InvertedIndex &inverted_index , const TranslationMatrix &translation_matrix , const std::vector<bool> &retranslate);
+
+	double threshold;
+
+	std::vector<size_t> offsets;
+
+	std::vector<int> postings_docs;
+
+	std::vector<int> postings_tfs;
+
+	std::vector<float> postings_masses;
+
+	std::vector<bool> materialized;
+
+	std::vector<int> lengths;
+
+	std::vector<int> ids;
+
+	//Accumulators used by translate , indexed by docid
+	std::vector<int> scratch_tfs;
+
+	std::vector<double> scratch_masses;
+
+	std::vector<int> touched;
+
+};
+
+
+void TranslatedIndex::translate(const int term , const InvertedIndex &inverted_index , const TranslationMatrix &translation_matrix){
+
+	touched.clear();
+
+	//The term and its translations are not all in the collection , their postings are only read if they have some
+	size_t nb_postings = inverted_index.postings_size(term);
+
+	const int* docs = nb_postings == 0 ? nullptr : inverted_index.docs(term);
+	const int* frequencies = nb_postings == 0 ? nullptr : inverted_index.tfs(term);
+
+	for(size_t l = 0 ; l < nb_postings ; l++){
+
+		touched.push_back(docs[l]);
+		scratch_tfs[docs[l]] = frequencies[l];
+
+	}
+
+	int term2;
+	double proba;
+
+	for(unsigned int j = 0 ; j < translation_matrix.row_size(term) ; j++){
+
+		term2 = translation_matrix.row_terms(term)[j];
+		proba = translation_matrix.row_probas(term)[j];
+
+		nb_postings = inverted_index.postings_size(term2);
+
+		if(nb_postings == 0){continue;}
+
+		docs = inverted_index.docs(term2);
+		frequencies = inverted_index.tfs(term2);
+
+		for(size_t l = 0 ; l < nb_postings ; l++){
+
+			if(scratch_tfs[docs[l]] == 0 && scratch_masses[docs[l]] == 0){touched.push_back(docs[l]);}
+			scratch_masses[docs[l]] += proba*frequencies[l];
+
+		}
+
+	}
+
+	std::sort(touched.begin() , touched.end());
+	touched.erase(std::unique(touched.begin() , touched.end()) , touched.end());
+
+	for(unsigned int l = 0 ; l < touched.size() ; l++){
+
+		postings_docs.push_back(touched[l]);
+		postings_tfs.push_back(scratch_tfs[touched[l]]);
+		postings_masses.push_back(scratch_masses[touched[l]]);
+
+		scratch_tfs[touched[l]] = 0;
+		scratch_masses[touched[l]] = 0;
+
+	}
+
+}
+
+
+void TranslatedIndex::rebuild(const InvertedIndex &inverted_index , const TranslationMatrix &translation_matrix , const std::vector<bool> &retranslate){
+
+	std::vector<size_t> old_offsets;
+	std::vector<int> old_docs;
+	std::vector<int> old_tfs;
+	std::vector<float> old_masses;
+
+	old_offsets.swap(offsets);
+	old_docs.swap(postings_docs);
+	old_tfs.swap(postings_tfs);
+	old_masses.swap(postings_masses);
+
+	size_t nb = materialized.size();
+
+	offsets.assign(nb + 1 , 0);
+
+	ids = inverted_index.doc_ids();
+	lengths.assign(ids.size() == 0 ? 0 : ids.back() + 1 , 0);
+
+	for(unsigned int l = 0 ; l < ids.size() ; l++){lengths[ids[l]] = inverted_index.doc_length(ids[l]);}
+
+	scratch_tfs.assign(lengths.size() , 0);
+	scratch_masses.assign(lengths.size() , 0);
+
+	for(unsigned int t = 0 ; t < nb ; t++){
+
+		if(materialized[t] && retranslate[t]){translate(t , inverted_index , translation_matrix);}
+
+		else if(materialized[t] && t + 1 < old_offsets.size()){
+
+			postings_docs.insert(postings_docs.end() , old_docs.begin() + old_offsets[t] , old_docs.begin() + old_offsets[t+1]);
+			postings_tfs.insert(postings_tfs.end() , old_tfs.begin() + old_offsets[t] , old_tfs.begin() + old_offsets[t+1]);
+			postings_masses.insert(postings_masses.end() , old_masses.begin() + old_offsets[t] , old_masses.begin() + old_offsets[t+1]);
+
+		}
+
+		offsets[t+1] = postings_docs.size();
+
+	}
+
+	std::vector<int>().swap(scratch_tfs);
+	std::vector<double>().swap(scratch_masses);
+
+}
+
+
+void TranslatedIndex::build(const InvertedIndex &inverted_index , const TranslationMatrix &translation_matrix , const double &threshold){
+
+	size_t nb = std::max(inverted_index.nb_terms() , translation_matrix.nb_terms());
+
+	std::vector<int> terms(nb);
+	for(unsigned int t = 0 ; t < nb ; t++){terms[t] = t;}
+
+	build(inverted_index , translation_matrix , threshold , terms);
+
+}
+
+
+void TranslatedIndex::build(const InvertedIndex &inverted_index , const TranslationMatrix &translation_matrix , const double &threshold , const std::vector<int> &terms){
+
+	this->threshold = threshold;
+
+	size_t nb = std::max(inverted_index.nb_terms() , translation_matrix.nb_terms());
+
+	for(unsigned int i = 0 ; i < terms.size() ; i++){nb = std::max(nb , (size_t)terms[i] + 1);}
+
+	materialized.assign(nb , false);
+
+	for(unsigned int i = 0 ; i < terms.size() ; i++){materialized[terms[i]] = true;}
+
+	offsets.clear();
+
+	rebuild(inverted_index , translation_matrix , materialized);
+
+}
+
+
+void TranslatedIndex::update(const InvertedIndex &inverted_index , const TranslationMatrix &previous_matrix , const TranslationMatrix &translation_matrix , const double &threshold){
+
+	this->threshold = threshold;
+
+	if(translation_matrix.nb_terms() > materialized.size()){materialized.resize(translation_matrix.nb_terms() , false);}
+
+	std::vector<bool> retranslate(materialized.size() , false);
+
+	size_t size;
+
+	for(unsigned int t = 0 ; t < materialized.size() ; t++){
+
+		if(!materialized[t]){continue;}
+
+		size = translation_matrix.row_size(t);
+
+		if(size != previous_matrix.row_size(t)){retranslate[t] = true; continue;}
+
+		for(unsigned int j = 0 ; j < size && !retranslate[t] ; j++){
+
+			if(translation_matrix.row_terms(t)[j] != previous_matrix.row_terms(t)[j] || translation_matrix.row_probas(t)[j] != previous_matrix.row_probas(t)[j]){retranslate[t] = true;}
+
+		}
+
+	}
+
+	rebuild(inverted_index , translation_matrix , retranslate);
+
+}
+
+
+//Magic number and version of the binary image of a translated index
+static const uint32_t translated_index_magic = 0x54504958;
+static const uint32_t translated_index_version = 3;
+
+
+bool TranslatedIndex::write(const std::string &file_name , const std::vector<std::string> &source_files)const{
+
+	BinaryImageWriter image(file_name , translated_index_magic , translated_index_version);
+
+	image.write_value((uint64_t)source_files.size());
+
+	for(unsigned int i = 0 ; i < source_files.size() ; i++){image.write_source(source_files[i]);}
+
+	std::vector<uint64_t> offsets64(offsets.begin() , offsets.end());
+	std::vector<char> flags(materialized.begin() , materialized.end());
+
+	image.write_value(threshold);
+	image.write_array(offsets64);
+	image.write_array(flags);
+	image.write_array(postings_docs);
+	image.write_array(postings_tfs);
+	image.write_array(postings_masses);
+	image.write_array(ids);
+	image.write_array(lengths);
+
+	return image.good() && image.close();
+
+}
+
+
+bool TranslatedIndex::read(const std::string &file_name , const std::vector<std::string> &source_files){
+
+	BinaryImageReader image(file_name , translated_index_magic , translated_index_version);
+
+	double file_threshold;
+	uint64_t nb_sources , nb_offsets , nb_flags , nb_docs , nb_tfs , nb_masses , nb_ids , nb_lengths;
+
+	if(!image.good() || !image.read_value(nb_sources) || nb_sources != source_files.size()){return false;}
+
+	std::string source;
+
+	for(unsigned int i = 0 ; i < source_files.size() ; i++){
+
+		if(!image.read_source(source) || source != source_files[i]){return false;}
+
+	}
+
+	if(!image.read_value(file_threshold)){return false;}
+
+	//The arrays are pointers into the mapping , bounded by the length of the file , and are only copied once they are consistent
+	const uint64_t* file_offsets = image.read_array<uint64_t>(nb_offsets);
+	const char* flags = image.read_array<char>(nb_flags);
+	const int* docs = image.read_array<int>(nb_docs);
+	const int* frequencies = image.read_array<int>(nb_tfs);
+	const float* file_masses = image.read_array<float>(nb_masses);
+	const int* file_ids = image.read_array<int>(nb_ids);
+	const int* file_lengths = image.read_array<int>(nb_lengths);
+
+	if(!image.good() || nb_offsets == 0 || nb_flags != nb_offsets - 1 || nb_tfs != nb_docs || nb_masses != nb_docs){return false;}
+
+	if(file_offsets[0] != 0 || file_offsets[nb_offsets - 1] != nb_docs){return false;}
+
+	for(uint64_t t = 0 ; t + 1 < nb_offsets ; t++){if(file_offsets[t] > file_offsets[t+1]){return false;}}
+
+	for(uint64_t l = 0 ; l < nb_docs ; l++){if(docs[l] < 0 || (uint64_t)docs[l] >= nb_lengths){return false;}}
+
+	for(uint64_t l = 0 ; l < nb_ids ; l++){if(file_ids[l] < 0 || (uint64_t)file_ids[l] >= nb_lengths){return false;}}
+
+	threshold = file_threshold;
+	offsets.assign(file_offsets , file_offsets + nb_offsets);
+	materialized.assign(flags , flags + nb_flags);
+	postings_docs.assign(docs , docs + nb_docs);
+	postings_tfs.assign(frequencies , frequencies + nb_tfs);
+	postings_masses.assign(file_masses , file_masses + nb_masses);
+	ids.assign(file_ids , file_ids + nb_ids);
+	lengths.assign(file_lengths , file_lengths + nb_lengths);
+
+	return true;
+
+}
+
+
+#endif
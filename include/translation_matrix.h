@@ -0,0 +1,226 @@
+#ifndef translation_matrix_h
+#define translation_matrix_h
+
+#include "neighbor_lists.h"
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+
+
+// Translation probabilities p( term1 | term2 ) = cos(term1 , term2)/sum of the similarities of term2 , in compressed sparse rows :
+// the row of term1 holds the terms term2 it can be translated from , sorted by id , and the probabilities already normalized.
+// The self translation term1 == term2 is not stored (see translation_proba in tool.h)
+class TranslationMatrix {
+
+public:
+
+	TranslationMatrix(){}
+
+	//Build the matrix from the maps returned by read_indexed_cos and all_fast_sum_cos_sim
+	TranslationMatrix(const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const std::unordered_map<int , double> &sum_cosine_map){build(cosine_map , sum_cosine_map);}
+
+	//Build the matrix from the similarities of the neighbor lists that are greater than threshold
+	TranslationMatrix(const NeighborLists &neighbor_lists , const double &threshold){build(neighbor_lists , threshold);}
+
+	void build(const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const std::unordered_map<int , double> &sum_cosine_map);
+
+	void build(const NeighborLists &neighbor_lists , const double &threshold);
+
+	//Number of rows (the largest term id + 1)
+	size_t nb_terms()const{return offsets.size() - 1;}
+
+	//Number of terms term1 can be translated from
+	size_t row_size(const int term1)const{
+
+		if(term1 < 0 || term1 >= (int)nb_terms()){return 0;}
+		return offsets[term1+1] - offsets[term1];
+
+	}
+
+	//Terms term1 can be translated from , in increasing order
+	const int* row_terms(const int term1)const{return terms.data() + offsets[term1];}
+
+	//Probabilities aligned with row_terms(term1)
+	const float* row_probas(const int term1)const{return probas.data() + offsets[term1];}
+
+	//Position of term2 in the row of term1 , or -1 if term1 cannot be translated from term2
+	int find(const int term1 , const int term2)const;
+
+	//Return true if term1 can be translated from term2
+	bool contains(const int term1 , const int term2)const{return find(term1 , term2) != -1;}
+
+	//Return p( term1 | term2 ) , 0 if term1 cannot be translated from term2
+	double proba(const int term1 , const int term2)const{
+
+		int position = find(term1 , term2);
+		return position == -1 ? 0 : row_probas(term1)[position];
+
+	}
+
+
+private:
+
+	//Sort every row by term id
+	void sort_rows();
+
+	std::vector<size_t> offsets;
+
+	std::vector<int> terms;
+
+	std::vector<float> probas;
+
+};
+
+
+void TranslationMatrix::build(const std::unordered_map< int , std::unordered_map<int,double> > &cosine_map , const std::unordered_map<int , double> &sum_cosine_map){
+
+	int max_term = -1;
+
+	auto iterator = cosine_map.begin();
+
+	while(iterator != cosine_map.end()){
+
+		max_term = std::max(max_term , iterator->first);
+		iterator++;
+
+	}
+
+	offsets.assign(max_term + 2 , 0);
+
+	for(iterator = cosine_map.begin() ; iterator != cosine_map.end() ; iterator++){
+
+		for(auto iterator2 = iterator->second.begin() ; iterator2 != iterator->second.end() ; iterator2++){
+
+			if(iterator2->first != iterator->first){offsets[iterator->first + 1]++;}
+
+		}
+
+	}
+
+	for(unsigned int t = 1 ; t < offsets.size() ; t++){offsets[t] += offsets[t-1];}
+
+	terms.resize(offsets.back());
+	probas.resize(offsets.back());
+
+	size_t position;
+
+	for(iterator = cosine_map.begin() ; iterator != cosine_map.end() ; iterator++){
+
+		position = offsets[iterator->first];
+
+		for(auto iterator2 = iterator->second.begin() ; iterator2 != iterator->second.end() ; iterator2++){
+
+			if(iterator2->first == iterator->first){continue;}
+
+			auto sum = sum_cosine_map.find(iterator2->first);
+
+			terms[position] = iterator2->first;
+			probas[position] = (sum == sum_cosine_map.end() || sum->second == 0) ? iterator2->second : iterator2->second/sum->second;
+			position++;
+
+		}
+
+	}
+
+	sort_rows();
+
+}
+
+
+void TranslationMatrix::build(const NeighborLists &neighbor_lists , const double &threshold){
+
+	offsets.assign(neighbor_lists.nb_terms() + 1 , 0);
+
+	//Length of the kept prefix of every list
+	std::vector<size_t> lengths(neighbor_lists.nb_terms() , 0);
+
+	for(unsigned int t = 0 ; t < neighbor_lists.nb_terms() ; t++){
+
+		lengths[t] = neighbor_lists.prefix_length(t , threshold);
+
+		for(unsigned int j = 0 ; j < lengths[t] ; j++){
+
+			if(neighbor_lists.neighbors(t)[j] != (int)t){offsets[t+1]++;}
+
+		}
+
+	}
+
+	for(unsigned int t = 1 ; t < offsets.size() ; t++){offsets[t] += offsets[t-1];}
+
+	terms.resize(offsets.back());
+	probas.resize(offsets.back());
+
+	size_t position;
+	double sum;
+	int term2;
+
+	for(unsigned int t = 0 ; t < neighbor_lists.nb_terms() ; t++){
+
+		position = offsets[t];
+
+		for(unsigned int j = 0 ; j < lengths[t] ; j++){
+
+			term2 = neighbor_lists.neighbors(t)[j];
+
+			if(term2 == (int)t){continue;}
+
+			sum = neighbor_lists.sum_cos(term2 , threshold);
+
+			terms[position] = term2;
+			probas[position] = sum == 0 ? neighbor_lists.similarities(t)[j] : neighbor_lists.similarities(t)[j]/sum;
+			position++;
+
+		}
+
+	}
+
+	sort_rows();
+
+}
+
+
+void TranslationMatrix::sort_rows(){
+
+	std::vector< std::pair<int,float> > row;
+
+	for(unsigned int t = 0 ; t < nb_terms() ; t++){
+
+		row.clear();
+
+		for(size_t j = offsets[t] ; j < offsets[t+1] ; j++){row.push_back(std::make_pair(terms[j] , probas[j]));}
+
+		std::sort(row.begin() , row.end());
+
+		for(unsigned int j = 0 ; j < row.size() ; j++){
+
+			terms[offsets[t] + j] = row[j].first;
+			probas[offsets[t] + j] = row[j].second;
+
+		}
+
+	}
+
+}
+
+
+int TranslationMatrix::find(const int term1 , const int term2)const{
+
+	size_t size = row_size(term1);
+
+	if(size == 0){return -1;}
+
+	const int* begin = row_terms(term1);
+	const int* end = begin + size;
+	const int* p = std::lower_bound(begin , end , term2);
+
+	if(p == end || *p != term2){return -1;}
+
+	return p - begin;
+
+}
+
+
+#endif
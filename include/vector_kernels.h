@@ -0,0 +1,634 @@
+#ifndef vector_kernels_h
+#define vector_kernels_h
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define x86_kernels
+#include <immintrin.h>
+#endif
+
+
+// Dot products of float vectors (the cosine similarity of normalized embeddings) with one kernel per instruction set : scalar , SSE ,
+// AVX2 + FMA and AVX-512. Every kernel is compiled for its own instruction set and the best one supported by the processor is chosen at
+// runtime , so the program does not need to be built with -mavx2. The usual sizes of the embeddings (100 , 300 and 768) have kernels
+// whose loops have a constant number of iterations , unrolled by the compiler. The same kernels exist for vectors quantized in half
+// precision (uint16_t , IEEE 754 binary16) and in bytes (int8_t , whose dot product is an integer to multiply by the scales of the vectors)
+
+
+enum KernelLevel { SCALAR_KERNELS , SSE_KERNELS , AVX2_KERNELS , AVX512_KERNELS };
+
+
+//Best instruction set supported by the processor
+KernelLevel detect_kernel_level(){
+
+#ifdef x86_kernels
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx512f")){return AVX512_KERNELS;}
+
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")){return AVX2_KERNELS;}
+
+	if(__builtin_cpu_supports("sse2")){return SSE_KERNELS;}
+#endif
+
+	return SCALAR_KERNELS;
+
+}
+
+
+//Instruction set of the kernels , detected once
+inline KernelLevel kernel_level(){
+
+	static const KernelLevel level = detect_kernel_level();
+
+	return level;
+
+}
+
+
+const char* kernel_name(const KernelLevel level){
+
+	switch(level){
+
+		case AVX512_KERNELS : return "AVX-512";
+		case AVX2_KERNELS : return "AVX2+FMA";
+		case SSE_KERNELS : return "SSE";
+		default : return "scalar";
+
+	}
+
+}
+
+
+//The loop used before the kernels , one product after the other
+inline float dot_product_scalar(const float* x , const float* y , const size_t n){
+
+	float dist = 0;
+
+	for(size_t i = 0 ; i < n ; i++){dist += x[i]*y[i];}
+
+	return dist;
+
+}
+
+
+//Half precision value of a float , rounded to the nearest even
+inline uint16_t float_to_half(const float value){
+
+	uint32_t bits;
+	memcpy(&bits , &value , sizeof(float));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t magnitude = bits & 0x7fffffff;
+
+	//Infinity and NaN
+	if(magnitude >= 0x7f800000){return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);}
+
+	//Rounded to infinity (65520 and more)
+	if(magnitude >= 0x477ff000){return sign | 0x7c00;}
+
+	uint32_t half , remainder , middle;
+
+	//Subnormal half (below 2^-14) : the mantissa with its implicit bit is shifted
+	if(magnitude < 0x38800000){
+
+		uint32_t shift = 126 - (magnitude >> 23);
+
+		if(shift > 24){return sign;}
+
+		uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+
+		half = mantissa >> shift;
+		remainder = mantissa & ((1u << shift) - 1);
+		middle = 1u << (shift - 1);
+
+	}
+
+	//Normal half : the exponent is rebiased from 127 to 15
+	else{
+
+		uint32_t rebiased = magnitude - 0x38000000;
+
+		half = rebiased >> 13;
+		remainder = rebiased & 0x1fff;
+		middle = 0x1000;
+
+	}
+
+	if(remainder > middle || (remainder == middle && (half & 1))){half++;}
+
+	return sign | half;
+
+}
+
+
+//Float value of a half precision value (exact)
+inline float half_to_float(const uint16_t value){
+
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+
+	if(exponent == 0){
+
+		float subnormal = mantissa*5.9604644775390625e-8f;
+
+		return sign ? -subnormal : subnormal;
+
+	}
+
+	uint32_t bits = sign | (exponent == 31 ? 0x7f800000 : (exponent + 112) << 23) | (mantissa << 13);
+
+	float result;
+	memcpy(&result , &bits , sizeof(float));
+
+	return result;
+
+}
+
+
+//x in half precision
+inline void to_half(const float* x , uint16_t* half , const size_t n){
+
+	for(size_t i = 0 ; i < n ; i++){half[i] = float_to_half(x[i]);}
+
+}
+
+
+//x in bytes : byte = round(x/scale) with scale = max |x| / 127 , return scale (0 for a null vector)
+inline float to_bytes(const float* x , int8_t* bytes , const size_t n){
+
+	float largest = 0;
+
+	for(size_t i = 0 ; i < n ; i++){largest = std::max(largest , std::abs(x[i]));}
+
+	float scale = largest/127;
+
+	for(size_t i = 0 ; i < n ; i++){bytes[i] = scale == 0 ? 0 : (int8_t)std::max(-127.0f , std::min(127.0f , std::round(x[i]/scale)));}
+
+	return scale;
+
+}
+
+
+inline float dot_product_scalar(const uint16_t* x , const uint16_t* y , const size_t n){
+
+	float dist = 0;
+
+	for(size_t i = 0 ; i < n ; i++){dist += half_to_float(x[i])*half_to_float(y[i]);}
+
+	return dist;
+
+}
+
+
+inline int dot_product_scalar(const int8_t* x , const int8_t* y , const size_t n){
+
+	int dist = 0;
+
+	for(size_t i = 0 ; i < n ; i++){dist += x[i]*y[i];}
+
+	return dist;
+
+}
+
+
+#ifdef x86_kernels
+
+//In the kernels below , n is fixed when it is not 0 , otherwise the size is given by size
+
+
+template<size_t fixed>
+__attribute__((target("sse2")))
+float dot_product_sse(const float* x , const float* y , const size_t size){
+
+	const size_t n = fixed ? fixed : size;
+
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+
+	size_t i = 0;
+
+	for(; i + 8 <= n ; i += 8){
+
+		sum0 = _mm_add_ps(sum0 , _mm_mul_ps(_mm_loadu_ps(x + i) , _mm_loadu_ps(y + i)));
+		sum1 = _mm_add_ps(sum1 , _mm_mul_ps(_mm_loadu_ps(x + i + 4) , _mm_loadu_ps(y + i + 4)));
+
+	}
+
+	for(; i + 4 <= n ; i += 4){sum0 = _mm_add_ps(sum0 , _mm_mul_ps(_mm_loadu_ps(x + i) , _mm_loadu_ps(y + i)));}
+
+	sum0 = _mm_add_ps(sum0 , sum1);
+	sum0 = _mm_add_ps(sum0 , _mm_movehl_ps(sum0 , sum0));
+	sum0 = _mm_add_ss(sum0 , _mm_shuffle_ps(sum0 , sum0 , 1));
+
+	float dist = _mm_cvtss_f32(sum0);
+
+	for(size_t j = n - n % 4 ; j < n ; j++){dist += x[j]*y[j];}
+
+	return dist;
+
+}
+
+
+//The bytes are widened to 16 bits and multiplied by pairs into 32 bits integers (madd)
+template<size_t fixed>
+__attribute__((target("sse2")))
+int dot_product_sse(const int8_t* x , const int8_t* y , const size_t size){
+
+	const size_t n = fixed ? fixed : size;
+
+	__m128i sum = _mm_setzero_si128();
+
+	for(size_t i = 0 ; i + 16 <= n ; i += 16){
+
+		__m128i bytes_x = _mm_loadu_si128((const __m128i*)(x + i));
+		__m128i bytes_y = _mm_loadu_si128((const __m128i*)(y + i));
+
+		//Sign extension : every byte is put in the high half of a 16 bits integer then shifted back
+		__m128i low_x = _mm_srai_epi16(_mm_unpacklo_epi8(bytes_x , bytes_x) , 8);
+		__m128i low_y = _mm_srai_epi16(_mm_unpacklo_epi8(bytes_y , bytes_y) , 8);
+		__m128i high_x = _mm_srai_epi16(_mm_unpackhi_epi8(bytes_x , bytes_x) , 8);
+		__m128i high_y = _mm_srai_epi16(_mm_unpackhi_epi8(bytes_y , bytes_y) , 8);
+
+		sum = _mm_add_epi32(sum , _mm_add_epi32(_mm_madd_epi16(low_x , low_y) , _mm_madd_epi16(high_x , high_y)));
+
+	}
+
+	sum = _mm_add_epi32(sum , _mm_shuffle_epi32(sum , 0x4E));
+	sum = _mm_add_epi32(sum , _mm_shuffle_epi32(sum , 0xB1));
+
+	int dist = _mm_cvtsi128_si32(sum);
+
+	for(size_t j = n - n % 16 ; j < n ; j++){dist += x[j]*y[j];}
+
+	return dist;
+
+}
+
+
+template<size_t fixed>
+__attribute__((target("avx2,fma")))
+float dot_product_avx2(const float* x , const float* y , const size_t size){
+
+	const size_t n = fixed ? fixed : size;
+
+	//4 independent sums so that the latency of the FMA is hidden
+	__m256 sum0 = _mm256_setzero_ps();
+	__m256 sum1 = _mm256_setzero_ps();
+	__m256 sum2 = _mm256_setzero_ps();
+	__m256 sum3 = _mm256_setzero_ps();
+
+	size_t i = 0;
+
+	for(; i + 32 <= n ; i += 32){
+
+		sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i) , _mm256_loadu_ps(y + i) , sum0);
+		sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8) , _mm256_loadu_ps(y + i + 8) , sum1);
+		sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 16) , _mm256_loadu_ps(y + i + 16) , sum2);
+		sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 24) , _mm256_loadu_ps(y + i + 24) , sum3);
+
+	}
+
+	for(; i + 8 <= n ; i += 8){sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i) , _mm256_loadu_ps(y + i) , sum0);}
+
+	__m256 sum = _mm256_add_ps(_mm256_add_ps(sum0 , sum1) , _mm256_add_ps(sum2 , sum3));
+
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum) , _mm256_extractf128_ps(sum , 1));
+	half = _mm_add_ps(half , _mm_movehl_ps(half , half));
+	half = _mm_add_ss(half , _mm_shuffle_ps(half , half , 1));
+
+	float dist = _mm_cvtss_f32(half);
+
+	for(size_t j = n - n % 8 ; j < n ; j++){dist += x[j]*y[j];}
+
+	return dist;
+
+}
+
+
+template<size_t fixed>
+__attribute__((target("avx2,fma,f16c")))
+float dot_product_avx2(const uint16_t* x , const uint16_t* y , const size_t size){
+
+	const size_t n = fixed ? fixed : size;
+
+	__m256 sum0 = _mm256_setzero_ps();
+	__m256 sum1 = _mm256_setzero_ps();
+
+	size_t i = 0;
+
+	for(; i + 16 <= n ; i += 16){
+
+		sum0 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(x + i))) , _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(y + i))) , sum0);
+		sum1 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(x + i + 8))) , _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(y + i + 8))) , sum1);
+
+	}
+
+	for(; i + 8 <= n ; i += 8){sum0 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(x + i))) , _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(y + i))) , sum0);}
+
+	//The last values are copied after zeros
+	if(i < n){
+
+		uint16_t last_x[8] = {0} , last_y[8] = {0};
+		memcpy(last_x , x + i , (n - i)*sizeof(uint16_t));
+		memcpy(last_y , y + i , (n - i)*sizeof(uint16_t));
+
+		sum0 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)last_x)) , _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)last_y)) , sum0);
+
+	}
+
+	__m256 sum = _mm256_add_ps(sum0 , sum1);
+
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum) , _mm256_extractf128_ps(sum , 1));
+	half = _mm_add_ps(half , _mm_movehl_ps(half , half));
+	half = _mm_add_ss(half , _mm_shuffle_ps(half , half , 1));
+
+	return _mm_cvtss_f32(half);
+
+}
+
+
+template<size_t fixed>
+__attribute__((target("avx2")))
+int dot_product_avx2(const int8_t* x , const int8_t* y , const size_t size){
+
+	const size_t n = fixed ? fixed : size;
+
+	__m256i sum0 = _mm256_setzero_si256();
+	__m256i sum1 = _mm256_setzero_si256();
+
+	size_t i = 0;
+
+	for(; i + 32 <= n ; i += 32){
+
+		sum0 = _mm256_add_epi32(sum0 , _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(x + i))) , _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(y + i)))));
+		sum1 = _mm256_add_epi32(sum1 , _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(x + i + 16))) , _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(y + i + 16)))));
+
+	}
+
+	for(; i + 16 <= n ; i += 16){sum0 = _mm256_add_epi32(sum0 , _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(x + i))) , _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(y + i)))));}
+
+	__m256i sum = _mm256_add_epi32(sum0 , sum1);
+
+	__m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum) , _mm256_extracti128_si256(sum , 1));
+	half = _mm_add_epi32(half , _mm_shuffle_epi32(half , 0x4E));
+	half = _mm_add_epi32(half , _mm_shuffle_epi32(half , 0xB1));
+
+	int dist = _mm_cvtsi128_si32(half);
+
+	for(size_t j = n - n % 16 ; j < n ; j++){dist += x[j]*y[j];}
+
+	return dist;
+
+}
+
+
+//Sum of the 16 values , by halves. The masked extraction avoids the _mm512 intrinsics whose undefined operand makes GCC 12 warn with -Wall
+__attribute__((target("avx512f")))
+inline float reduce_avx512(const __m512 sum){
+
+	__m256 low = _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd() , 0xF , _mm512_castps_pd(sum) , 0));
+	__m256 high = _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd() , 0xF , _mm512_castps_pd(sum) , 1));
+	__m256 halves = _mm256_add_ps(low , high);
+
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(halves) , _mm256_extractf128_ps(halves , 1));
+	half = _mm_add_ps(half , _mm_movehl_ps(half , half));
+	half = _mm_add_ss(half , _mm_shuffle_ps(half , half , 1));
+
+	return _mm_cvtss_f32(half);
+
+}
+
+
+template<size_t fixed>
+__attribute__((target("avx512f")))
+float dot_product_avx512(const float* x , const float* y , const size_t size){
+
+	const size_t n = fixed ? fixed : size;
+
+	__m512 sum0 = _mm512_setzero_ps();
+	__m512 sum1 = _mm512_setzero_ps();
+
+	size_t i = 0;
+
+	for(; i + 32 <= n ; i += 32){
+
+		sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i) , _mm512_loadu_ps(y + i) , sum0);
+		sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 16) , _mm512_loadu_ps(y + i + 16) , sum1);
+
+	}
+
+	if(i + 16 <= n){
+
+		sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i) , _mm512_loadu_ps(y + i) , sum0);
+		i += 16;
+
+	}
+
+	//The last values are copied after zeros
+	if(i < n){
+
+		float last_x[16] = {0} , last_y[16] = {0};
+		memcpy(last_x , x + i , (n - i)*sizeof(float));
+		memcpy(last_y , y + i , (n - i)*sizeof(float));
+
+		sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(last_x) , _mm512_loadu_ps(last_y) , sum1);
+
+	}
+
+	return reduce_avx512(_mm512_add_ps(sum0 , sum1));
+
+}
+
+
+//16 half precision values in floats , masked for the same reason as reduce_avx512
+__attribute__((target("avx512f")))
+inline __m512 half_to_float_avx512(const __m256i half){return _mm512_mask_cvtph_ps(_mm512_setzero_ps() , 0xFFFF , half);}
+
+
+template<size_t fixed>
+__attribute__((target("avx512f")))
+float dot_product_avx512(const uint16_t* x , const uint16_t* y , const size_t size){
+
+	const size_t n = fixed ? fixed : size;
+
+	__m512 sum0 = _mm512_setzero_ps();
+	__m512 sum1 = _mm512_setzero_ps();
+
+	size_t i = 0;
+
+	for(; i + 32 <= n ; i += 32){
+
+		sum0 = _mm512_fmadd_ps(half_to_float_avx512(_mm256_loadu_si256((const __m256i*)(x + i))) , half_to_float_avx512(_mm256_loadu_si256((const __m256i*)(y + i))) , sum0);
+		sum1 = _mm512_fmadd_ps(half_to_float_avx512(_mm256_loadu_si256((const __m256i*)(x + i + 16))) , half_to_float_avx512(_mm256_loadu_si256((const __m256i*)(y + i + 16))) , sum1);
+
+	}
+
+	for(; i + 16 <= n ; i += 16){sum0 = _mm512_fmadd_ps(half_to_float_avx512(_mm256_loadu_si256((const __m256i*)(x + i))) , half_to_float_avx512(_mm256_loadu_si256((const __m256i*)(y + i))) , sum0);}
+
+	//The last values are copied after zeros
+	if(i < n){
+
+		uint16_t last_x[16] = {0} , last_y[16] = {0};
+		memcpy(last_x , x + i , (n - i)*sizeof(uint16_t));
+		memcpy(last_y , y + i , (n - i)*sizeof(uint16_t));
+
+		sum1 = _mm512_fmadd_ps(half_to_float_avx512(_mm256_loadu_si256((const __m256i*)last_x)) , half_to_float_avx512(_mm256_loadu_si256((const __m256i*)last_y)) , sum1);
+
+	}
+
+	return reduce_avx512(_mm512_add_ps(sum0 , sum1));
+
+}
+
+
+//Kernel of the instruction set , with the loops of constant length for the usual sizes
+template<template<size_t> class Kernel , class T>
+inline auto dispatch_size(const T* x , const T* y , const size_t n) -> decltype(Kernel<0>::run(x , y , n)){
+
+	switch(n){
+
+		case 100 : return Kernel<100>::run(x , y , n);
+		case 300 : return Kernel<300>::run(x , y , n);
+		case 768 : return Kernel<768>::run(x , y , n);
+		default : return Kernel<0>::run(x , y , n);
+
+	}
+
+}
+
+
+//The kernels of an instruction set , the ones it does not have being the ones of the previous instruction set
+template<size_t fixed> struct SseKernel {
+
+	static float run(const float* x , const float* y , const size_t n){return dot_product_sse<fixed>(x , y , n);}
+
+	static float run(const uint16_t* x , const uint16_t* y , const size_t n){return dot_product_scalar(x , y , n);}
+
+	static int run(const int8_t* x , const int8_t* y , const size_t n){return dot_product_sse<fixed>(x , y , n);}
+
+};
+
+template<size_t fixed> struct Avx2Kernel {
+
+	static float run(const float* x , const float* y , const size_t n){return dot_product_avx2<fixed>(x , y , n);}
+
+	static float run(const uint16_t* x , const uint16_t* y , const size_t n){return dot_product_avx2<fixed>(x , y , n);}
+
+	static int run(const int8_t* x , const int8_t* y , const size_t n){return dot_product_avx2<fixed>(x , y , n);}
+
+};
+
+//Without AVX-512BW , the bytes are multiplied with AVX2
+template<size_t fixed> struct Avx512Kernel {
+
+	static float run(const float* x , const float* y , const size_t n){return dot_product_avx512<fixed>(x , y , n);}
+
+	static float run(const uint16_t* x , const uint16_t* y , const size_t n){return dot_product_avx512<fixed>(x , y , n);}
+
+	static int run(const int8_t* x , const int8_t* y , const size_t n){return dot_product_avx2<fixed>(x , y , n);}
+
+};
+
+#endif
+
+
+//Dot product of x and y (of size n) with the kernels of level , which must be supported by the processor
+inline float dot_product(const float* x , const float* y , const size_t n , const KernelLevel level){
+
+#ifdef x86_kernels
+	switch(level){
+
+		case AVX512_KERNELS : return dispatch_size<Avx512Kernel>(x , y , n);
+		case AVX2_KERNELS : return dispatch_size<Avx2Kernel>(x , y , n);
+		case SSE_KERNELS : return dispatch_size<SseKernel>(x , y , n);
+		default : break;
+
+	}
+#endif
+
+	return dot_product_scalar(x , y , n);
+
+}
+
+
+//Dot product of x and y with the best kernels of the processor
+inline float dot_product(const float* x , const float* y , const size_t n){return dot_product(x , y , n , kernel_level());}
+
+
+//Same as before for vectors in half precision
+inline float dot_product(const uint16_t* x , const uint16_t* y , const size_t n , const KernelLevel level){
+
+#ifdef x86_kernels
+	switch(level){
+
+		case AVX512_KERNELS : return dispatch_size<Avx512Kernel>(x , y , n);
+		case AVX2_KERNELS : return dispatch_size<Avx2Kernel>(x , y , n);
+		case SSE_KERNELS : return dispatch_size<SseKernel>(x , y , n);
+		default : break;
+
+	}
+#endif
+
+	return dot_product_scalar(x , y , n);
+
+}
+
+
+inline float dot_product(const uint16_t* x , const uint16_t* y , const size_t n){return dot_product(x , y , n , kernel_level());}
+
+
+//Same as before for vectors in bytes , the dot product of the quantized vectors being this integer times their scales
+inline int dot_product(const int8_t* x , const int8_t* y , const size_t n , const KernelLevel level){
+
+#ifdef x86_kernels
+	switch(level){
+
+		case AVX512_KERNELS : return dispatch_size<Avx512Kernel>(x , y , n);
+		case AVX2_KERNELS : return dispatch_size<Avx2Kernel>(x , y , n);
+		case SSE_KERNELS : return dispatch_size<SseKernel>(x , y , n);
+		default : break;
+
+	}
+#endif
+
+	return dot_product_scalar(x , y , n);
+
+}
+
+
+inline int dot_product(const int8_t* x , const int8_t* y , const size_t n){return dot_product(x , y , n , kernel_level());}
+
+
+//y += x
+inline void add_vector(float* y , const float* x , const size_t n){
+
+	#pragma omp simd
+	for(size_t i = 0 ; i < n ; i++){y[i] += x[i];}
+
+}
+
+
+//Divide x by its norm (unless it is 0) and return the norm
+inline float normalize_vector(float* x , const size_t n){
+
+	float len = std::sqrt(dot_product(x , x , n));
+
+	if(len != 0){
+
+		#pragma omp simd
+		for(size_t i = 0 ; i < n ; i++){x[i] /= len;}
+
+	}
+
+	return len;
+
+}
+
+
+#endif
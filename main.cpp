@@ -25,6 +25,7 @@ int main(int argc, char** argv) {
 	std::string collection_file = "../data/collection/porter_stop_string_content";
 	std::string queries_file = "../data/queries/porter_stop_queries.txt";
 	std::string index_file = "../data/index/porter_index";
+	std::string image_file = "../data/index/porter_image";
 
 	if(argc > 2 && std::string(argv[2]) == "nostem"){
 
@@ -47,33 +48,87 @@ int main(int argc, char** argv) {
 
 	}
 
+	//Write the binary image of the indexed collection , read by the next experiments instead of the text files as long as they are not modified
+	else if(argc > 1 && std::string(argv[1]) == "index"){
+
+		if(!index_collection(collection_file , queries_file , image_file)){std::cout<<"Could not write "<<image_file<<std::endl; return 1;}
+
+		return 0;
+
+	}
+
+	//Write the binary image of the shard argv[2] of argv[3] , built without loading the whole collection
+	else if(argc > 3 && std::string(argv[1]) == "shard"){
+
+		std::string shard_file = image_file + "_shard_" + argv[2];
+
+		if(!write_shard_image(shard_file , collection_file , queries_file , atoi(argv[2]) , atoi(argv[3]))){std::cout<<"Could not write "<<shard_file<<std::endl; return 1;}
+
+		return 0;
+
+	}
+
 	else if(argc > 1 && std::string(argv[1]) == "hiemstra"){
 
 		std::string res_file = "../data/res/hiemstra/results";
-		hiemstra_test(collection_file , queries_file , res_file);
+		hiemstra_test(collection_or_image(collection_file , queries_file , image_file) , queries_file , res_file);
 
 	}
 
 	else if(argc > 1 && std::string(argv[1]) == "dirichlet"){
 
 		std::string res_file = "../data/res/dirichlet/results";
-		dirichlet_test(collection_file , queries_file , res_file);
+		dirichlet_test(collection_or_image(collection_file , queries_file , image_file) , queries_file , res_file);
+
+	}
+
+	//Size and speed of the codecs of the compressed postings lists
+	else if(argc > 1 && std::string(argv[1]) == "compression"){
+
+		compression_test(collection_or_image(collection_file , queries_file , image_file) , queries_file);
+
+	}
+
+	//Hiemstra over an impact ordered index , with limits on the postings read and on the time of a query
+	else if(argc > 1 && std::string(argv[1]) == "impact"){
+
+		std::string res_file = "../data/res/impact/results";
+		impact_test(collection_or_image(collection_file , queries_file , image_file) , queries_file , res_file);
+
+	}
+
+	//GFLOP/s of the dot products of the embeddings with the kernels of every instruction set
+	else if(argc > 1 && std::string(argv[1]) == "kernels"){
+
+		kernels_test();
+
+	}
+
+	//Memory , cosine error and speed of the embeddings in half precision and in bytes
+	else if(argc > 1 && std::string(argv[1]) == "quantization"){
+
+		std::string embeddings_file = "../data/embeddings/GoogleNews-vectors-negative300/GoogleNews-vectors-negative300.bin";
+		quantization_test(embeddings_file , embeddings_file + ".cache");
 
 	}
 
 
-	else if(argc > 1 && std::string(argv[1]) == "embedding"){
+	//Write the translated indexes of the thresholds of the "embedding" experiments , read by them instead of being built again
+	else if(argc > 1 && (std::string(argv[1]) == "embedding" || std::string(argv[1]) == "translate")){
 
 		std::string res_file = "../data/res/embedding/results|";
 		std::string collection_cosine_file = "../data/embeddings/GoogleNews-vectors-negative300/indexed_porter_stop_cos";
 		std::string queries_cosine_file = "../data/embeddings/GoogleNews-vectors-negative300/indexed_porter_stop_cos_queries";
+		std::string translated_file = "../data/index/porter_translated";
 		if(argc > 2 && std::string(argv[2]) == "nostem"){
 
 			collection_cosine_file = "../data/embeddings/GoogleNews-vectors-negative300/indexed_stop_cos";
 			queries_cosine_file = "../data/embeddings/GoogleNews-vectors-negative300/indexed_stop_cos_queries";
+			translated_file = "../data/index/stop_translated";
 
 		}
-		embedding_test(collection_file , queries_file , index_file , res_file , collection_cosine_file , queries_cosine_file);
+		if(std::string(argv[1]) == "translate"){translate_test(collection_file , queries_file , index_file , collection_cosine_file , queries_cosine_file , translated_file);}
+		else{embedding_test(collection_file , queries_file , index_file , res_file , collection_cosine_file , queries_cosine_file , translated_file);}
 
 	}
 